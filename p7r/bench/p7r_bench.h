@@ -0,0 +1,39 @@
+#ifndef     P7R_BENCH_H_
+#define     P7R_BENCH_H_
+
+#include    <stdio.h>
+#include    <stdint.h>
+#include    <stdlib.h>
+#include    <time.h>
+
+/*
+ * Shared bits of p7r microbenchmarks - a clock and a one-line JSON record per measurement, so runs of different
+ * builds can be diffed by a script.
+ */
+
+static inline
+uint64_t p7r_bench_now_ns(void) {
+    struct timespec timeval;
+    clock_gettime(CLOCK_MONOTONIC, &timeval);
+    return ((uint64_t) timeval.tv_sec * 1000 * 1000 * 1000) + (uint64_t) timeval.tv_nsec;
+}
+
+static inline
+uint64_t p7r_bench_arg(int argc, char **argv, int index, uint64_t fallback) {
+    return (argc > index) ? strtoull(argv[index], NULL, 0) : fallback;
+}
+
+static inline
+void p7r_bench_report(const char *bench, const char *variant, uint64_t n_threads, uint64_t n_operations, uint64_t elapsed_ns) {
+    double seconds = (double) elapsed_ns / 1e9;
+    printf(
+        "{\"bench\": \"%s\", \"variant\": \"%s\", \"threads\": %lu, \"operations\": %lu, \"elapsed_ns\": %lu, "
+        "\"ops_per_sec\": %.1f, \"ns_per_op\": %.2f}\n",
+        bench, variant, n_threads, n_operations, elapsed_ns,
+        seconds > 0 ? (double) n_operations / seconds : 0.0,
+        n_operations ? (double) elapsed_ns / (double) n_operations : 0.0
+    );
+    fflush(stdout);
+}
+
+#endif      // P7R_BENCH_H_
@@ -0,0 +1,49 @@
+#!/usr/bin/env perl
+
+# Compares two runs of `make run` record by record - ns per operation of the same bench, variant and threads.
+# Exits 1 if anything got slower by more than the threshold, in percent.
+#
+# usage: p7r_bench_compare.pl <baseline.jsonl> <candidate.jsonl> [threshold]
+
+use strict;
+use warnings;
+
+use JSON::PP;
+
+die "usage: $0 <baseline.jsonl> <candidate.jsonl> [threshold]\n" if @ARGV < 2;
+my ($baseline_path, $candidate_path, $threshold) = @ARGV;
+$threshold //= 10;
+
+sub load_records {
+    my ($path) = @_;
+    my (%records, @order);
+    open(my $input, '<', $path) or die "$path: $!\n";
+    while (my $line = <$input>) {
+        next unless $line =~ /^\s*\{/;
+        my $record = decode_json($line);
+        my $key = "$record->{bench}/$record->{variant}/$record->{threads}";
+        push @order, $key unless exists $records{$key};
+        $records{$key} = $record;
+    }
+    close($input);
+    return (\%records, \@order);
+}
+
+my ($baseline, undef) = load_records($baseline_path);
+my ($candidate, $order) = load_records($candidate_path);
+
+my $n_regressions = 0;
+printf("%-56s %14s %14s %9s\n", 'bench/variant/threads', 'baseline ns', 'candidate ns', 'change');
+for my $key (@$order) {
+    my $after = $candidate->{$key}{ns_per_op};
+    unless (exists $baseline->{$key}) {
+        printf("%-56s %14s %14.2f %9s\n", $key, '-', $after, 'new');
+        next;
+    }
+    my $before = $baseline->{$key}{ns_per_op};
+    my $change = $before > 0 ? 100.0 * ($after - $before) / $before : 0.0;
+    my $regressed = $change > $threshold;
+    $n_regressions++ if $regressed;
+    printf("%-56s %14.2f %14.2f %+8.1f%%%s\n", $key, $before, $after, $change, $regressed ? '  REGRESSION' : '');
+}
+exit($n_regressions ? 1 : 0);
@@ -0,0 +1,133 @@
+#include    <pthread.h>
+
+#include    "./p7r_bench.h"
+#include    "../p7r_cpbuffer.h"
+#include    "../p7r_inbox.h"
+
+/*
+ * u2cc delivery: one p7r_cpbuffer per producer scanned on every refresh, as the scheduler bus used to do,
+ * against a single MPSC p7r_inbox.
+ *
+ * usage: p7r_bench_inbox [n_producers] [n_boxes] [n_messages_per_producer] [n_empty_refreshes]
+ */
+
+#define     CP_BUFFER_RETRY_TIMES       5
+
+struct bench_context {
+    uint32_t n_producers, n_boxes;
+    uint64_t n_messages;
+    struct p7r_cpbuffer *boxes;
+    struct p7r_inbox inbox;
+    list_ctl_t **nodes;
+    int start;
+};
+
+struct producer_argument {
+    struct bench_context *context;
+    uint32_t index;
+    int use_inbox;
+};
+
+static
+void *producer(void *argument_) {
+    struct producer_argument *argument = argument_;
+    struct bench_context *context = argument->context;
+    list_ctl_t *nodes = context->nodes[argument->index];
+    while (!__atomic_load_n(&(context->start), __ATOMIC_ACQUIRE))
+        ;
+    for (uint64_t index = 0; index < context->n_messages; index++)
+        if (argument->use_inbox)
+            p7r_inbox_push(&(context->inbox), &(nodes[index]));
+        else
+            cp_buffer_produce(&(context->boxes[argument->index]), &(nodes[index]));
+    return NULL;
+}
+
+static
+uint64_t consume_cpbuffer(struct bench_context *context) {
+    uint64_t n_consumed = 0;
+    for (uint32_t box_index = 0; box_index < context->n_boxes; box_index++) {
+        list_ctl_t *target_queue;
+        uint32_t n_retry_times = CP_BUFFER_RETRY_TIMES;
+        do {
+            target_queue = cp_buffer_consume(&(context->boxes[box_index]));
+        } while (!target_queue && --n_retry_times);
+        list_ctl_t *p, *t;
+        list_foreach_remove(p, target_queue, t) {
+            list_del(t);
+            n_consumed++;
+        }
+    }
+    return n_consumed;
+}
+
+static
+uint64_t consume_inbox(struct bench_context *context) {
+    list_ctl_t messages, *p, *t;
+    init_list_head(&messages);
+    uint64_t n_consumed = p7r_inbox_drain(&(context->inbox), &messages);
+    list_foreach_remove(p, &messages, t)
+        list_del(t);
+    return n_consumed;
+}
+
+static
+void run_contended(struct bench_context *context, int use_inbox) {
+    pthread_t threads[context->n_producers];
+    struct producer_argument arguments[context->n_producers];
+    uint64_t n_expected = context->n_messages * context->n_producers, n_consumed = 0, n_refreshes = 0;
+
+    context->start = 0;
+    for (uint32_t index = 0; index < context->n_producers; index++) {
+        arguments[index] = (struct producer_argument) { .context = context, .index = index, .use_inbox = use_inbox };
+        pthread_create(&(threads[index]), NULL, producer, &(arguments[index]));
+    }
+    uint64_t begin = p7r_bench_now_ns();
+    __atomic_store_n(&(context->start), 1, __ATOMIC_RELEASE);
+    while (n_consumed < n_expected) {
+        n_consumed += use_inbox ? consume_inbox(context) : consume_cpbuffer(context);
+        n_refreshes++;
+    }
+    uint64_t elapsed = p7r_bench_now_ns() - begin;
+    for (uint32_t index = 0; index < context->n_producers; index++)
+        pthread_join(threads[index], NULL);
+    p7r_bench_report(use_inbox ? "u2cc_delivery_inbox" : "u2cc_delivery_cpbuffer", "contended", context->n_producers, n_consumed, elapsed);
+}
+
+static
+void run_empty_refresh(struct bench_context *context, int use_inbox, uint64_t n_refreshes) {
+    uint64_t begin = p7r_bench_now_ns(), n_consumed = 0;
+    for (uint64_t index = 0; index < n_refreshes; index++)
+        n_consumed += use_inbox ? consume_inbox(context) : consume_cpbuffer(context);
+    uint64_t elapsed = p7r_bench_now_ns() - begin;
+    p7r_bench_report(use_inbox ? "u2cc_refresh_inbox" : "u2cc_refresh_cpbuffer", "empty", 1, n_refreshes + n_consumed, elapsed);
+}
+
+int main(int argc, char **argv) {
+    struct bench_context context = {
+        .n_producers = p7r_bench_arg(argc, argv, 1, 4),
+        .n_boxes = p7r_bench_arg(argc, argv, 2, 64),
+        .n_messages = p7r_bench_arg(argc, argv, 3, 1 << 18),
+    };
+    uint64_t n_empty_refreshes = p7r_bench_arg(argc, argv, 4, 1 << 20);
+    (context.n_boxes < context.n_producers) && (context.n_boxes = context.n_producers);
+
+    context.boxes = malloc(sizeof(struct p7r_cpbuffer) * context.n_boxes);
+    context.nodes = malloc(sizeof(list_ctl_t *) * context.n_producers);
+    for (uint32_t index = 0; index < context.n_boxes; index++)
+        cp_buffer_init(&(context.boxes[index]));
+    for (uint32_t index = 0; index < context.n_producers; index++)
+        context.nodes[index] = malloc(sizeof(list_ctl_t) * context.n_messages);
+    p7r_inbox_init(&(context.inbox));
+
+    run_contended(&context, 0);
+    run_contended(&context, 1);
+    run_empty_refresh(&context, 0, n_empty_refreshes);
+    run_empty_refresh(&context, 1, n_empty_refreshes);
+
+    for (uint32_t index = 0; index < context.n_producers; index++)
+        free(context.nodes[index]);
+    free(context.nodes);
+    free(context.boxes);
+    return 0;
+}
@@ -0,0 +1,45 @@
+#include    "./p7r_bench.h"
+#include    "../p7r_mcontext_x64.h"
+
+/*
+ * Context switch round trips between the main context and a fresh one, full-register switch against the
+ * callee-saved-only one. Every p7r_yield and p7r_delegate pays one of these.
+ *
+ * usage: p7r_bench_mcontext [n_switches]
+ */
+
+#define     BENCH_STACK_SIZE        (64 * 1024)
+
+typedef void (*switch_fn_t)(struct p7r_mcontext_x64 *, struct p7r_mcontext_x64 *);
+
+static struct p7r_mcontext_x64 main_context, peer_context;
+static switch_fn_t switch_fn;
+
+static
+void peer_entrance(void *argument) {
+    (void) argument;
+    for (;;)
+        switch_fn(&main_context, &peer_context);
+}
+
+static
+void run(const char *variant, switch_fn_t fn, uint64_t n_switches) {
+    char *stack = aligned_alloc(16, BENCH_STACK_SIZE);
+    switch_fn = fn;
+    p7r_mcontext_x64_init(&peer_context, peer_entrance, NULL, stack + BENCH_STACK_SIZE - 16);
+    fn(&peer_context, &main_context);
+
+    uint64_t begin = p7r_bench_now_ns();
+    for (uint64_t index = 0; index < n_switches; index += 2)
+        fn(&peer_context, &main_context);
+    uint64_t elapsed = p7r_bench_now_ns() - begin;
+    p7r_bench_report("mcontext_switch", variant, 1, n_switches, elapsed);
+    free(stack);
+}
+
+int main(int argc, char **argv) {
+    uint64_t n_switches = p7r_bench_arg(argc, argv, 1, 1 << 24);
+    run("full", p7r_mcontext_x64_switch, n_switches);
+    run("callee_saved", p7r_mcontext_x64_swap, n_switches);
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include    "./p7r_bench.h"
+#include    "../p7r_root_alloc.h"
+#include    "../p7r_stack_allocator.h"
+
+/*
+ * Stack allocator on its own: allocate/free pairs while the long-term zone has room, the same once it is held in
+ * full and every stack comes from a slave, and bursts of twice the zone which make slaves come and go. The one held
+ * in full runs n_operations / 256 pairs.
+ *
+ * usage: p7r_bench_stack [n_stacks_long_term] [n_operations]
+ */
+
+#define     BENCH_PAGES_PER_STACK   16
+
+static
+void run_pairs(const char *variant, struct p7r_stack_allocator *allocator, uint64_t n_operations) {
+    uint64_t begin = p7r_bench_now_ns();
+    for (uint64_t index = 0; index < n_operations; index++) {
+        struct p7r_stack_metamark *mark = p7r_stack_allocate(P7R_STACK_SOURCE_DEFAULT, allocator, P7R_STACK_CLASS_DEFAULT);
+        if (mark == NULL)
+            break;
+        p7r_stack_free(mark);
+    }
+    p7r_bench_report("stack_allocate_free", variant, 1, n_operations, p7r_bench_now_ns() - begin);
+}
+
+int main(int argc, char **argv) {
+    uint32_t n_stacks = p7r_bench_arg(argc, argv, 1, 256);
+    uint64_t n_operations = p7r_bench_arg(argc, argv, 2, 1 << 20);
+
+    {
+        __auto_type allocator_real = p7r_root_alloc_get_allocator();
+        allocator_real->allocator_.closure_ = malloc;
+        allocator_real->deallocator_.closure_ = free;
+        allocator_real->reallocator_.closure_ = realloc;
+    }
+    static struct p7r_stack_allocator allocator;
+    struct p7r_stack_allocator_config config = {
+        .n_pages_long_term = n_stacks * BENCH_PAGES_PER_STACK, .n_pages_short_term = n_stacks * BENCH_PAGES_PER_STACK,
+        .n_pages_slave = (n_stacks / 4 ? n_stacks / 4 : 1) * BENCH_PAGES_PER_STACK,
+        .n_pages_stack_total = BENCH_PAGES_PER_STACK, .n_bytes_page = 4096
+    };
+    if (p7r_stack_allocator_init(&allocator, config) == NULL)
+        return 1;
+    struct p7r_stack_metamark **held = malloc(sizeof(struct p7r_stack_metamark *) * n_stacks * 2);
+    if (held == NULL)
+        return 1;
+
+    run_pairs("zone", &allocator, n_operations);
+
+    // the zone taken in full - whatever comes next, comes from a slave
+    uint32_t n_held = 0;
+    while ((n_held < n_stacks) && (held[n_held] = p7r_stack_allocate(P7R_STACK_SOURCE_DEFAULT, &allocator, P7R_STACK_CLASS_DEFAULT)))
+        n_held++;
+    // every pair maps a slave and drops it again - far slower, fewer rounds do
+    run_pairs("zone_exhausted", &allocator, (n_operations >> 8) ? n_operations >> 8 : 1);
+    while (n_held)
+        p7r_stack_free(held[--n_held]);
+
+    // twice the zone at once and back - slaves get mapped, and dropped again when they run empty
+    uint64_t n_rounds = n_operations / (n_stacks * 2) ? n_operations / (n_stacks * 2) : 1;
+    uint64_t begin = p7r_bench_now_ns();
+    for (uint64_t round = 0; round < n_rounds; round++) {
+        while ((n_held < n_stacks * 2) && (held[n_held] = p7r_stack_allocate(P7R_STACK_SOURCE_DEFAULT, &allocator, P7R_STACK_CLASS_DEFAULT)))
+            n_held++;
+        while (n_held)
+            p7r_stack_free(held[--n_held]);
+    }
+    p7r_bench_report("stack_allocate_free", "burst_beyond_zone", 1, n_rounds * n_stacks * 2, p7r_bench_now_ns() - begin);
+
+    free(held);
+    p7r_stack_allocator_ruin(&allocator);
+    return 0;
+}
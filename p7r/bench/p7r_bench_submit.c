@@ -0,0 +1,127 @@
+#include    <pthread.h>
+
+#include    "./p7r_bench.h"
+#include    "../p7r_api.h"
+
+/*
+ * Foreign submission throughput: n application threads pushing tiny tasks into the pool at once, one by one
+ * through p7r_execute, through p7r_execute behind a spinlock per target carrier as submission used to be, and in
+ * batches through p7r_execute_batch.
+ *
+ * usage: p7r_bench_submit [n_submitters] [n_carriers] [n_tasks_per_submitter] [batch_size]
+ */
+
+#define     LEGACY_MAX_CARRIERS     256
+
+struct bench_context {
+    uint32_t n_submitters, n_carriers, batch_size;
+    uint64_t n_tasks;
+    uint64_t n_done;
+    pthread_spinlock_t legacy_locks[LEGACY_MAX_CARRIERS];
+    int start;
+};
+
+enum { VARIANT_EXECUTE, VARIANT_LEGACY_SPINLOCK, VARIANT_BATCH, N_VARIANTS };
+
+static const char *variant_names[N_VARIANTS] = {
+    [VARIANT_EXECUTE] = "execute",
+    [VARIANT_LEGACY_SPINLOCK] = "execute_spinlocked",
+    [VARIANT_BATCH] = "execute_batch",
+};
+
+struct submitter_argument {
+    struct bench_context *context;
+    int variant;
+};
+
+static struct bench_context *bench_context;
+
+static
+void task(void *argument) {
+    __atomic_add_fetch(&(bench_context->n_done), 1, __ATOMIC_RELAXED);
+}
+
+static
+void *submitter(void *argument_) {
+    struct submitter_argument *argument = argument_;
+    struct bench_context *context = argument->context;
+    struct p7r_task tasks[context->batch_size];
+    uint32_t legacy_cursor = (uint32_t) (uintptr_t) &tasks;
+    for (uint32_t index = 0; index < context->batch_size; index++)
+        tasks[index] = (struct p7r_task) { .entrance = task };
+    while (!__atomic_load_n(&(context->start), __ATOMIC_ACQUIRE))
+        ;
+    switch (argument->variant) {
+        case VARIANT_EXECUTE:
+            for (uint64_t index = 0; index < context->n_tasks; index++)
+                p7r_execute(task, NULL, NULL);
+            break;
+        case VARIANT_LEGACY_SPINLOCK:
+            for (uint64_t index = 0; index < context->n_tasks; index++) {
+                pthread_spinlock_t *lock = &(context->legacy_locks[legacy_cursor++ % context->n_carriers]);
+                pthread_spin_lock(lock);
+                p7r_execute(task, NULL, NULL);
+                pthread_spin_unlock(lock);
+            }
+            break;
+        case VARIANT_BATCH:
+            for (uint64_t index = 0; index < context->n_tasks; index += context->batch_size) {
+                uint64_t n_left = context->n_tasks - index;
+                p7r_execute_batch(tasks, (n_left < context->batch_size) ? n_left : context->batch_size);
+            }
+            break;
+    }
+    return NULL;
+}
+
+static
+void run(struct bench_context *context, int variant) {
+    pthread_t threads[context->n_submitters];
+    struct submitter_argument arguments[context->n_submitters];
+    uint64_t n_expected = __atomic_load_n(&(context->n_done), __ATOMIC_RELAXED) + context->n_tasks * context->n_submitters;
+
+    context->start = 0;
+    for (uint32_t index = 0; index < context->n_submitters; index++) {
+        arguments[index] = (struct submitter_argument) { .context = context, .variant = variant };
+        pthread_create(&(threads[index]), NULL, submitter, &(arguments[index]));
+    }
+    uint64_t begin = p7r_bench_now_ns();
+    __atomic_store_n(&(context->start), 1, __ATOMIC_RELEASE);
+    for (uint32_t index = 0; index < context->n_submitters; index++)
+        pthread_join(threads[index], NULL);
+    uint64_t submitted = p7r_bench_now_ns() - begin;
+    while (__atomic_load_n(&(context->n_done), __ATOMIC_RELAXED) < n_expected)
+        usleep(100);
+    uint64_t completed = p7r_bench_now_ns() - begin;
+    p7r_bench_report("foreign_submit", variant_names[variant], context->n_submitters, context->n_tasks * context->n_submitters, submitted);
+    p7r_bench_report("foreign_submit_completed", variant_names[variant], context->n_submitters, context->n_tasks * context->n_submitters, completed);
+}
+
+int main(int argc, char **argv) {
+    static struct bench_context context;
+    (context.n_submitters = p7r_bench_arg(argc, argv, 1, 32)), (context.n_carriers = p7r_bench_arg(argc, argv, 2, 4));
+    (context.n_tasks = p7r_bench_arg(argc, argv, 3, 1 << 15)), (context.batch_size = p7r_bench_arg(argc, argv, 4, 64));
+    (context.n_carriers > LEGACY_MAX_CARRIERS) && (context.n_carriers = LEGACY_MAX_CARRIERS);
+    (context.batch_size == 0) && (context.batch_size = 1);
+    for (uint32_t index = 0; index < context.n_carriers; index++)
+        pthread_spin_init(&(context.legacy_locks[index]), PTHREAD_PROCESS_PRIVATE);
+    bench_context = &context;
+
+    struct p7r_config config = {
+        .concurrency = { .n_carriers = context.n_carriers, .event_buffer_capacity = 64 },
+        .root_allocator = { .allocate = malloc, .deallocate = free, .reallocate = realloc },
+        .stack_allocator = {
+            .n_pages_long_term = 8192, .n_pages_short_term = 8192, .n_pages_slave = 4096,
+            .n_pages_stack_total = 16, .n_bytes_page = 4096
+        },
+    };
+    p7r_poolize(config);
+    while (p7r_poolization_status() == 0)
+        usleep(1000);
+    if (p7r_poolization_status() < 0)
+        return 1;
+
+    for (int variant = 0; variant < N_VARIANTS; variant++)
+        run(&context, variant);
+    return 0;
+}
@@ -0,0 +1,174 @@
+#include    "./p7r_bench.h"
+#include    "../p7r_api.h"
+#include    "../p7r_channel.h"
+
+/*
+ * The scheduler from inside the pool - a driver uthread on carrier 0 runs every bench in turn, carrier 1 plays the
+ * remote side:
+ *   uthread_create         create and run to completion, on the carrier itself and on the other one, in rounds
+ *   yield                  two uthreads yielding to each other
+ *   u2cc_round_trip        a rendezvous over two channels with a uthread on the other carrier - two wakes by u2cc
+ *   timer                  uthreads sleeping 0 ms over and over, each sleep a timer inserted and expired
+ *   submit_wait            p7r_submit and p7r_future_wait of an empty task, from the application and from a uthread
+ *
+ * usage: p7r_bench_uthread [n_operations] [n_sleepers]
+ */
+
+#define     BENCH_CREATE_ROUND      256
+
+struct bench_context {
+    uint64_t n_operations;
+    uint32_t n_sleepers;
+    uint64_t n_done;
+    struct p7r_channel pings, pongs;
+    int finished;
+};
+
+static struct bench_context *bench_context;
+
+static
+void task(void *argument) {
+    __atomic_add_fetch(&(bench_context->n_done), 1, __ATOMIC_RELAXED);
+}
+
+// whoever submits waits for the future - it is ours to post
+static
+void answer(void *argument) {
+    struct p7r_future *future = p7r_get_future();
+    future && (p7r_future_post(future), 0);
+}
+
+static
+void yielder(void *argument) {
+    for (uint64_t index = 0; index < bench_context->n_operations; index++)
+        p7r_yield();
+    task(argument);
+}
+
+static
+void ponger(void *argument) {
+    uint64_t ball;
+    while (p7r_channel_recv(&(bench_context->pings), &ball) == 0)
+        p7r_channel_send(&(bench_context->pongs), &ball);
+}
+
+static
+void sleeper(void *argument) {
+    uint64_t n_sleeps = (uint64_t) argument;
+    for (uint64_t index = 0; index < n_sleeps; index++)
+        p7r_delegate(P7R_DELEGATION_TIMED, (uint64_t) 0);
+    task(argument);
+}
+
+static
+void wait_done(uint64_t n_expected) {
+    while (__atomic_load_n(&(bench_context->n_done), __ATOMIC_RELAXED) < n_expected)
+        p7r_yield();
+}
+
+static
+void bench_create(const char *variant, int remote) {
+    uint64_t n_expected = __atomic_load_n(&(bench_context->n_done), __ATOMIC_RELAXED);
+    uint64_t begin = p7r_bench_now_ns();
+    // in rounds - a local uthread takes its stack right away, and all of them at once would measure slaves
+    for (uint64_t index = 0; index < bench_context->n_operations; index++) {
+        remote ?
+            p7r_uthread_create_foreign(1, task, NULL, NULL, NULL, P7R_STACK_CLASS_AUTO, P7R_PRIORITY_INHERIT) :
+            p7r_uthread_create(task, NULL, NULL, 0);
+        n_expected++;
+        ((n_expected % BENCH_CREATE_ROUND) == 0) && (wait_done(n_expected), 0);
+    }
+    wait_done(n_expected);
+    p7r_bench_report("uthread_create", variant, 1, bench_context->n_operations, p7r_bench_now_ns() - begin);
+}
+
+static
+void bench_yield(void) {
+    uint64_t n_expected = __atomic_load_n(&(bench_context->n_done), __ATOMIC_RELAXED) + 1;
+    p7r_uthread_create(yielder, NULL, NULL, 1);
+    uint64_t begin = p7r_bench_now_ns();
+    for (uint64_t index = 0; index < bench_context->n_operations; index++)
+        p7r_yield();
+    uint64_t elapsed = p7r_bench_now_ns() - begin;
+    wait_done(n_expected);
+    p7r_bench_report("yield", "ping_pong", 2, bench_context->n_operations * 2, elapsed);
+}
+
+static
+void bench_round_trip(void) {
+    p7r_channel_init(&(bench_context->pings), sizeof(uint64_t), 0);
+    p7r_channel_init(&(bench_context->pongs), sizeof(uint64_t), 0);
+    p7r_uthread_create_foreign(1, ponger, NULL, NULL, NULL, P7R_STACK_CLASS_AUTO, P7R_PRIORITY_INHERIT);
+    uint64_t begin = p7r_bench_now_ns();
+    for (uint64_t ball = 0; ball < bench_context->n_operations; ball++) {
+        p7r_channel_send(&(bench_context->pings), &ball);
+        p7r_channel_recv(&(bench_context->pongs), &ball);
+    }
+    uint64_t elapsed = p7r_bench_now_ns() - begin;
+    p7r_channel_close(&(bench_context->pings));
+    p7r_bench_report("u2cc_round_trip", "channel_rendezvous", 2, bench_context->n_operations, elapsed);
+}
+
+static
+void bench_timer(void) {
+    uint32_t n_sleepers = bench_context->n_sleepers;
+    uint64_t n_sleeps = bench_context->n_operations / n_sleepers ? bench_context->n_operations / n_sleepers : 1;
+    uint64_t n_expected = __atomic_load_n(&(bench_context->n_done), __ATOMIC_RELAXED) + n_sleepers;
+    uint64_t begin = p7r_bench_now_ns();
+    for (uint32_t index = 0; index < n_sleepers; index++)
+        p7r_uthread_create(sleeper, (void *) n_sleeps, NULL, 0);
+    wait_done(n_expected);
+    p7r_bench_report("timer", "insert_expire", n_sleepers, n_sleeps * n_sleepers, p7r_bench_now_ns() - begin);
+}
+
+static
+void bench_submit_wait(const char *variant) {
+    uint64_t begin = p7r_bench_now_ns();
+    for (uint64_t index = 0; index < bench_context->n_operations; index++) {
+        struct p7r_future *future = p7r_submit(answer, NULL, NULL);
+        if (future == NULL)
+            break;
+        p7r_future_wait(future);
+        p7r_future_release(future);
+    }
+    p7r_bench_report("submit_wait", variant, 1, bench_context->n_operations, p7r_bench_now_ns() - begin);
+}
+
+static
+void driver(void *argument) {
+    bench_create("local", 0);
+    bench_create("remote", 1);
+    bench_yield();
+    bench_round_trip();
+    bench_timer();
+    bench_submit_wait("uthread");
+    __atomic_store_n(&(bench_context->finished), 1, __ATOMIC_RELEASE);
+}
+
+int main(int argc, char **argv) {
+    static struct bench_context context;
+    (context.n_operations = p7r_bench_arg(argc, argv, 1, 1 << 16)), (context.n_sleepers = p7r_bench_arg(argc, argv, 2, 64));
+    (context.n_sleepers == 0) && (context.n_sleepers = 1);
+    bench_context = &context;
+
+    struct p7r_config config = {
+        // uthreads created in a uthread stay on its carrier, whatever the depth of its queue
+        .concurrency = { .n_carriers = 2, .event_buffer_capacity = 64, .placement = { .policy = P7R_PLACEMENT_LOAD_AWARE, .saturation = UINT32_MAX } },
+        .root_allocator = { .allocate = malloc, .deallocate = free, .reallocate = realloc },
+        .stack_allocator = {
+            .n_pages_long_term = 8192, .n_pages_short_term = 8192, .n_pages_slave = 4096,
+            .n_pages_stack_total = 16, .n_bytes_page = 4096
+        },
+    };
+    p7r_poolize(config);
+    while (p7r_poolization_status() == 0)
+        usleep(1000);
+    if (p7r_poolization_status() < 0)
+        return 1;
+
+    p7r_uthread_create_foreign(0, driver, NULL, NULL, NULL, P7R_STACK_CLASS_AUTO, P7R_PRIORITY_NORMAL);
+    while (!__atomic_load_n(&(context.finished), __ATOMIC_ACQUIRE))
+        usleep(1000);
+    bench_submit_wait("application");
+    return 0;
+}
@@ -8,12 +8,13 @@ use Servbuild::Makemaker::C;
 
 %Servbuild::Makemaker::C::assignments_overwritten = (
     CFLAGS => '-c -fPIC -O2 -g -std=gnu11',
-    LDFLAGS => '-shared -lpthread',
+    LDFLAGS => '-shared -lpthread -ldl',
     TARGET => 'libp7r.so.0.0.1',
 );
 
 @Servbuild::Makemaker::C::sources = (
     `ls *.c`,
+    `ls *.S`,
     '../util/scraft_hashtable.c',
     '../util/scraft_rbt.c',
 );
@@ -7,12 +7,25 @@
 #include    "../util/scraft_arena.c"
 
 
+struct p7r_followup {
+    void (*entrance)(void *);
+    void *argument;
+    void (*dtor)(void *);
+};
+
+struct p7r_gather {
+    struct p7r_future *combined;
+    uint32_t n_pending;         // inputs not posted yet, plus the one who hooks them up
+    int decided;                // the combined future is posted, or about to be
+    int error_code;             // first error among the inputs, when_all only
+};
+
+
 static
 struct p7r_poolized_meta {
     pthread_t main_thread;
     int pool_alive;
     int startup_channel[2];
-    pthread_spinlock_t *foreign_request_mutex;
 } meta_singleton = { .pool_alive = 0 };
 
 static
@@ -44,15 +57,8 @@ int p7r_poolize_(struct p7r_config config) {
         return -1;
     if (ret < 0)
         return -1;
-    uint32_t n_carriers = p7r_n_carriers();
-    if (unlikely((meta_singleton.foreign_request_mutex = scraft_allocate(allocator, sizeof(pthread_spinlock_t) * n_carriers)) == NULL))
-        return -1;
-    for (uint32_t target_index = 0; target_index < n_carriers; target_index++)
-        pthread_spin_init(&(meta_singleton.foreign_request_mutex[target_index]), PTHREAD_PROCESS_PRIVATE);
-    if (pipe(meta_singleton.startup_channel) == -1) {
-        scraft_deallocate(allocator, (void *) meta_singleton.foreign_request_mutex);
+    if (pipe(meta_singleton.startup_channel) == -1)
         return -1;
-    }
     __atomic_store_n(&(meta_singleton.pool_alive), 1, __ATOMIC_RELAXED);
     return p7r_poolized_main_entrance(&meta_singleton), 0;
 }
@@ -69,39 +75,166 @@ int p7r_poolization_status(void) {
 }
 
 int p7r_poolize(struct p7r_config config) {
+    // the pool thread outlives this frame - hand it a copy which stays
+    static struct p7r_config config_retained;
+    config_retained = config;
     pthread_attr_t detach_attr;
     pthread_attr_init(&detach_attr);
     pthread_attr_setdetachstate(&detach_attr, PTHREAD_CREATE_DETACHED);
-    return pthread_create(&(meta_singleton.main_thread), &detach_attr, p7r_poolized_main_thread, &config);
+    return pthread_create(&(meta_singleton.main_thread), &detach_attr, p7r_poolized_main_thread, &config_retained);
 }
 
-int p7r_execute(void (*entrance)(void *), void *argument, void (*dtor)(void *)) {
-    uint32_t target = balanced_target_carrier();
-    int ret = -1;
-    pthread_spin_lock(&(meta_singleton.foreign_request_mutex[target]));
-    {
-        ret = p7r_uthread_create_foreign(target, entrance, argument, dtor, NULL);
-    }
-    pthread_spin_unlock(&(meta_singleton.foreign_request_mutex[target]));
-    return ret;
+// Foreign threads post straight into the MPSC inbox of the target carrier - nothing to serialize on.
+static
+int p7r_execute_(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t stack_class, uint32_t priority) {
+    return p7r_uthread_create_foreign(balanced_target_carrier(), entrance, argument, dtor, NULL, stack_class, priority);
 }
 
-struct p7r_future *p7r_submit(void (*entrance)(void *), void *argument, void (*dtor)(void *)) {
+static
+struct p7r_future *p7r_submit_(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t stack_class, uint32_t priority) {
     struct p7r_future *result = scraft_arena_get();
     if (unlikely(result == NULL))
         return NULL;
     p7r_future_init(result);
-    uint32_t target = balanced_target_carrier();
-    int ret = -1;
-    pthread_spin_lock(&(meta_singleton.foreign_request_mutex[target]));
-    {
-        ret = p7r_uthread_create_foreign(target, entrance, argument, dtor, result);
+    if (unlikely(p7r_uthread_create_foreign(balanced_target_carrier(), entrance, argument, dtor, result, stack_class, priority) == -1)) {
+        p7r_future_release(result);
+        return NULL;
     }
-    pthread_spin_unlock(&(meta_singleton.foreign_request_mutex[target]));
     return result;
 }
 
+int p7r_execute_sized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t stack_class) {
+    return p7r_execute_(entrance, argument, dtor, stack_class, P7R_PRIORITY_INHERIT);
+}
+
+struct p7r_future *p7r_submit_sized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t stack_class) {
+    return p7r_submit_(entrance, argument, dtor, stack_class, P7R_PRIORITY_INHERIT);
+}
+
+int p7r_execute_prioritized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t priority) {
+    return p7r_execute_(entrance, argument, dtor, P7R_STACK_CLASS_AUTO, priority);
+}
+
+struct p7r_future *p7r_submit_prioritized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t priority) {
+    return p7r_submit_(entrance, argument, dtor, P7R_STACK_CLASS_AUTO, priority);
+}
+
+int p7r_execute(void (*entrance)(void *), void *argument, void (*dtor)(void *)) {
+    return p7r_execute_sized(entrance, argument, dtor, P7R_STACK_CLASS_AUTO);
+}
+
+struct p7r_future *p7r_submit(void (*entrance)(void *), void *argument, void (*dtor)(void *)) {
+    return p7r_submit_sized(entrance, argument, dtor, P7R_STACK_CLASS_AUTO);
+}
+
+uint32_t p7r_execute_batch(const struct p7r_task *tasks, uint32_t n_tasks) {
+    return p7r_uthread_create_foreign_batch(tasks, NULL, n_tasks);
+}
+
+uint32_t p7r_submit_batch(const struct p7r_task *tasks, uint32_t n_tasks, struct p7r_future **futures) {
+    uint32_t n_futures, n_posted;
+    for (n_futures = 0; n_futures < n_tasks; n_futures++) {
+        if (unlikely((futures[n_futures] = scraft_arena_get()) == NULL))
+            break;
+        p7r_future_init(futures[n_futures]);
+    }
+    n_posted = p7r_uthread_create_foreign_batch(tasks, futures, n_futures);
+    for (uint32_t index = n_posted; index < n_tasks; index++) {
+        (index < n_futures) && (p7r_future_release(futures[index]), 0);
+        futures[index] = NULL;
+    }
+    return n_posted;
+}
+
 void p7r_future_release(struct p7r_future *future) {
     p7r_future_ruin(future);
     scraft_arena_release(future);
 }
+
+static
+void p7r_followup_launch(struct p7r_future *future, void *followup_) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    struct p7r_followup *followup = followup_;
+    if (unlikely(p7r_execute(followup->entrance, followup->argument, followup->dtor) == -1))
+        followup->dtor && (followup->dtor(followup->argument), 0);
+    scraft_deallocate(allocator, followup);
+}
+
+int p7r_future_then_execute(struct p7r_future *future, void (*entrance)(void *), void *argument, void (*dtor)(void *)) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    struct p7r_followup *followup = scraft_allocate(allocator, sizeof(struct p7r_followup));
+    if (unlikely(followup == NULL))
+        return -1;
+    (followup->entrance = entrance), (followup->argument = argument), (followup->dtor = dtor);
+    if (unlikely(p7r_future_then(future, p7r_followup_launch, followup) == -1)) {
+        scraft_deallocate(allocator, followup);
+        return -1;
+    }
+    return 0;
+}
+
+static inline
+int p7r_gather_claim(struct p7r_gather *gather) {
+    return !__atomic_exchange_n(&(gather->decided), 1, __ATOMIC_ACQ_REL);
+}
+
+static inline
+void p7r_gather_publish(struct p7r_gather *gather, void *result, int error_code) {
+    (p7r_future_store_result(gather->combined, result)), (p7r_future_set_error(gather->combined, error_code));
+    p7r_future_post(gather->combined);
+}
+
+// The combined future is touched by whoever decides it only - its owner may release it right after the post.
+static
+void p7r_gather_unref(struct p7r_gather *gather, uint32_t n) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    if (__atomic_sub_fetch(&(gather->n_pending), n, __ATOMIC_ACQ_REL) != 0)
+        return;
+    p7r_gather_claim(gather) && (p7r_gather_publish(gather, NULL, gather->error_code), 0);
+    scraft_deallocate(allocator, gather);
+}
+
+static
+void p7r_gather_all(struct p7r_future *future, void *gather_) {
+    struct p7r_gather *gather = gather_;
+    int error_code = p7r_future_get_error(future), expected = 0;
+    error_code && __atomic_compare_exchange_n(&(gather->error_code), &expected, error_code, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+    p7r_gather_unref(gather, 1);
+}
+
+static
+void p7r_gather_any(struct p7r_future *future, void *gather_) {
+    struct p7r_gather *gather = gather_;
+    // the losers leave the input alone, its owner may be done with it by now
+    p7r_gather_claim(gather) && (p7r_gather_publish(gather, future, p7r_future_get_error(future)), 0);
+    p7r_gather_unref(gather, 1);
+}
+
+static
+struct p7r_future *p7r_gather(struct p7r_future *const *futures, uint32_t n_futures, void (*callback)(struct p7r_future *, void *)) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    struct p7r_future *combined = scraft_arena_get();
+    if (unlikely(combined == NULL))
+        return NULL;
+    p7r_future_init(combined);
+    struct p7r_gather *gather = scraft_allocate(allocator, sizeof(struct p7r_gather));
+    if (unlikely(gather == NULL))
+        return p7r_future_release(combined), NULL;
+    // our own reference keeps the record, and when_all undecided, until every input is hooked up
+    (gather->combined = combined), (gather->n_pending = n_futures + 1), (gather->decided = 0), (gather->error_code = 0);
+    uint32_t n_hooked;
+    for (n_hooked = 0; n_hooked < n_futures; n_hooked++)
+        if (unlikely(p7r_future_then(futures[n_hooked], callback, gather) == -1))
+            break;
+    (n_hooked < n_futures) && p7r_gather_claim(gather) && (p7r_gather_publish(gather, NULL, ENOMEM), 0);
+    p7r_gather_unref(gather, n_futures - n_hooked + 1);
+    return combined;
+}
+
+struct p7r_future *p7r_when_all(struct p7r_future *const *futures, uint32_t n_futures) {
+    return p7r_gather(futures, n_futures, p7r_gather_all);
+}
+
+struct p7r_future *p7r_when_any(struct p7r_future *const *futures, uint32_t n_futures) {
+    return p7r_gather(futures, n_futures, p7r_gather_any);
+}
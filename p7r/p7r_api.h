@@ -6,15 +6,38 @@
 #include    "./p7r_uthread.h"
 
 #include    "./p7r_future.h"
+#include    "./p7r_channel.h"
+#include    "./p7r_sync.h"
 
 
 int p7r_poolization_status(void);
 int p7r_poolize(struct p7r_config config);
 int p7r_execute(void (*entrance)(void *), void *argument, void (*dtor)(void *));
+int p7r_execute_sized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t stack_class);
 
 struct p7r_future *p7r_submit(void (*entrance)(void *), void *argument, void (*dtor)(void *));
+struct p7r_future *p7r_submit_sized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t stack_class);
+// P7R_PRIORITY_* - the others run at the priority of the calling uthread, or at normal from outside
+int p7r_execute_prioritized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t priority);
+struct p7r_future *p7r_submit_prioritized(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t priority);
+
+// both return how many tasks went out, p7r_submit_batch sets futures[i] for those and NULL for the rest
+uint32_t p7r_execute_batch(const struct p7r_task *tasks, uint32_t n_tasks);
+uint32_t p7r_submit_batch(const struct p7r_task *tasks, uint32_t n_tasks, struct p7r_future **futures);
 void p7r_future_release(struct p7r_future *future);
 
+// executes the entrance once the future is posted - nothing waits for it in the meantime
+int p7r_future_then_execute(struct p7r_future *future, void (*entrance)(void *), void *argument, void (*dtor)(void *));
+
+/*
+ * Futures of their own, to be released like those of p7r_submit, posted once every one of the futures is posted
+ * (carrying the first error among them), or once the first one is (with it as the result and its error).
+ * The futures must not be released before they are posted. Either fails with ENOMEM as error when it cannot
+ * hook itself up to all of them.
+ */
+struct p7r_future *p7r_when_all(struct p7r_future *const *futures, uint32_t n_futures);
+struct p7r_future *p7r_when_any(struct p7r_future *const *futures, uint32_t n_futures);
+
 static inline
 void p7r_future_release_scoped(struct p7r_future **arg) {
     p7r_future_release(*arg);
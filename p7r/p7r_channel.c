@@ -0,0 +1,199 @@
+#include    "./p7r_channel.h"
+#include    "./p7r_uthread.h"
+#include    "./p7r_root_alloc.h"
+
+#include    <sys/syscall.h>
+#include    <linux/futex.h>
+
+
+static inline
+void *p7r_channel_slot(struct p7r_channel *channel, uint32_t index) {
+    return channel->buffer + ((channel->head + index) % channel->capacity) * channel->element_size;
+}
+
+static inline
+struct p7r_channel_op *p7r_channel_op_pop(list_ctl_t *waiters) {
+    if (list_is_empty(waiters))
+        return NULL;
+    list_ctl_t *first = waiters->next;
+    list_del(first);
+    return container_of(first, struct p7r_channel_op, linkable);
+}
+
+// Settles a parked op claimed under the lock - it must not be touched afterwards, its frame may be gone.
+static
+void p7r_channel_op_wake(struct p7r_channel_op *op) {
+    if (op->delegation) {
+        p7r_waiter_wake(op->delegation);
+        return;
+    }
+    __atomic_store_n(&(op->futex), 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &(op->futex), FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+// Under the lock: completes op if it can, returns the parked peer it completed along the way (to be woken), or
+// op itself if it cannot complete yet.
+static
+struct p7r_channel_op *p7r_channel_try_locked(struct p7r_channel *channel, struct p7r_channel_op *op, int *completed) {
+    struct p7r_channel_op *peer = NULL;
+    *completed = 1;
+    if (op->direction == P7R_CHANNEL_SEND) {
+        if (channel->closed)
+            op->status = P7R_CHANNEL_OP_CLOSED;
+        else if ((peer = p7r_channel_op_pop(&(channel->receivers))) != NULL)
+            (memcpy(peer->element, op->element, channel->element_size)), (peer->status = P7R_CHANNEL_OP_DONE), (op->status = P7R_CHANNEL_OP_DONE);
+        else if (channel->n_elements < channel->capacity)
+            (memcpy(p7r_channel_slot(channel, channel->n_elements++), op->element, channel->element_size)), (op->status = P7R_CHANNEL_OP_DONE);
+        else
+            *completed = 0;
+        return peer;
+    }
+    if (channel->n_elements) {
+        memcpy(op->element, p7r_channel_slot(channel, 0), channel->element_size);
+        (channel->head = (channel->head + 1) % channel->capacity), (channel->n_elements--);
+        // room again - the longest parked sender gets in
+        if ((peer = p7r_channel_op_pop(&(channel->senders))) != NULL)
+            (memcpy(p7r_channel_slot(channel, channel->n_elements++), peer->element, channel->element_size)), (peer->status = P7R_CHANNEL_OP_DONE);
+        op->status = P7R_CHANNEL_OP_DONE;
+    } else if ((peer = p7r_channel_op_pop(&(channel->senders))) != NULL)
+        (memcpy(op->element, peer->element, channel->element_size)), (peer->status = P7R_CHANNEL_OP_DONE), (op->status = P7R_CHANNEL_OP_DONE);
+    else if (channel->closed)
+        op->status = P7R_CHANNEL_OP_CLOSED;
+    else
+        *completed = 0;
+    return peer;
+}
+
+static
+int p7r_channel_op_arm(struct p7r_oob_source *source, struct p7r_delegation *delegation) {
+    struct p7r_channel_op *op = container_of(source, struct p7r_channel_op, source), *peer;
+    struct p7r_channel *channel = op->channel;
+    int completed;
+    pthread_spin_lock(&(channel->lock));
+    if (((peer = p7r_channel_try_locked(channel, op, &completed)), !completed)) {
+        op->delegation = delegation;
+        list_add_tail(&(op->linkable), (op->direction == P7R_CHANNEL_SEND) ? &(channel->senders) : &(channel->receivers));
+    }
+    pthread_spin_unlock(&(channel->lock));
+    peer && (p7r_channel_op_wake(peer), 0);
+    return completed;
+}
+
+static
+int p7r_channel_op_disarm(struct p7r_oob_source *source, struct p7r_delegation *delegation) {
+    struct p7r_channel_op *op = container_of(source, struct p7r_channel_op, source);
+    struct p7r_channel *channel = op->channel;
+    int still_parked;
+    pthread_spin_lock(&(channel->lock));
+    if ((still_parked = (op->status == P7R_CHANNEL_OP_PENDING)))
+        list_del(&(op->linkable));
+    pthread_spin_unlock(&(channel->lock));
+    return still_parked;
+}
+
+static
+struct p7r_oob_source *p7r_channel_op_prepare(struct p7r_channel_op *op, struct p7r_channel *channel, void *element, int direction) {
+    (op->source.arm = p7r_channel_op_arm), (op->source.disarm = p7r_channel_op_disarm);
+    (op->channel = channel), (op->element = element), (op->direction = direction);
+    (op->status = P7R_CHANNEL_OP_PENDING), (op->delegation = NULL), (op->futex = 0);
+    return &(op->source);
+}
+
+static
+int p7r_channel_os_wait(struct p7r_channel_op *op) {
+    struct p7r_channel *channel = op->channel;
+    struct p7r_channel_op *peer;
+    int completed;
+    pthread_spin_lock(&(channel->lock));
+    if (((peer = p7r_channel_try_locked(channel, op, &completed)), !completed))
+        list_add_tail(&(op->linkable), (op->direction == P7R_CHANNEL_SEND) ? &(channel->senders) : &(channel->receivers));
+    pthread_spin_unlock(&(channel->lock));
+    peer && (p7r_channel_op_wake(peer), 0);
+    while (!__atomic_load_n(&(op->futex), __ATOMIC_ACQUIRE) && !completed)
+        syscall(SYS_futex, &(op->futex), FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+    return (op->status == P7R_CHANNEL_OP_DONE) ? 0 : -1;
+}
+
+static
+int p7r_channel_transfer(struct p7r_channel *channel, void *element, int direction) {
+    struct p7r_channel_op op;
+    p7r_channel_op_prepare(&op, channel, element, direction);
+    if (!p7r_in_uthread())
+        return p7r_channel_os_wait(&op);
+    p7r_delegate(P7R_DELEGATION_ALLOW_OOB, &(op.source));
+    return (op.status == P7R_CHANNEL_OP_DONE) ? 0 : -1;
+}
+
+static
+int p7r_channel_try_transfer(struct p7r_channel *channel, void *element, int direction) {
+    struct p7r_channel_op op, *peer;
+    int completed;
+    p7r_channel_op_prepare(&op, channel, element, direction);
+    pthread_spin_lock(&(channel->lock));
+    peer = p7r_channel_try_locked(channel, &op, &completed);
+    pthread_spin_unlock(&(channel->lock));
+    peer && (p7r_channel_op_wake(peer), 0);
+    if (!completed)
+        return (errno = EAGAIN), -1;
+    return (op.status == P7R_CHANNEL_OP_DONE) ? 0 : ((errno = EPIPE), -1);
+}
+
+int p7r_channel_init(struct p7r_channel *channel, uint32_t element_size, uint32_t capacity) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    (channel->element_size = element_size), (channel->capacity = capacity);
+    (channel->head = channel->n_elements = 0), (channel->closed = 0), (channel->buffer = NULL);
+    init_list_head(&(channel->senders));
+    init_list_head(&(channel->receivers));
+    if (capacity && unlikely((channel->buffer = scraft_allocate(allocator, (size_t) element_size * capacity)) == NULL))
+        return -1;
+    return pthread_spin_init(&(channel->lock), PTHREAD_PROCESS_PRIVATE);
+}
+
+void p7r_channel_ruin(struct p7r_channel *channel) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    channel->buffer && (scraft_deallocate(allocator, channel->buffer), 0);
+    pthread_spin_destroy(&(channel->lock));
+}
+
+void p7r_channel_close(struct p7r_channel *channel) {
+    list_ctl_t parked, *p, *t;
+    init_list_head(&parked);
+    pthread_spin_lock(&(channel->lock));
+    channel->closed = 1;
+    // receivers only park on an empty buffer, so nobody parked can complete any more
+    list_foreach_remove(p, &(channel->senders), t)
+        list_del(t), list_add_tail(t, &parked);
+    list_foreach_remove(p, &(channel->receivers), t)
+        list_del(t), list_add_tail(t, &parked);
+    list_foreach_remove(p, &parked, t)
+        container_of(t, struct p7r_channel_op, linkable)->status = P7R_CHANNEL_OP_CLOSED;
+    pthread_spin_unlock(&(channel->lock));
+    list_foreach_remove(p, &parked, t) {
+        list_del(t);
+        p7r_channel_op_wake(container_of(t, struct p7r_channel_op, linkable));
+    }
+}
+
+int p7r_channel_send(struct p7r_channel *channel, const void *element) {
+    return p7r_channel_transfer(channel, (void *) element, P7R_CHANNEL_SEND);
+}
+
+int p7r_channel_recv(struct p7r_channel *channel, void *element) {
+    return p7r_channel_transfer(channel, element, P7R_CHANNEL_RECV);
+}
+
+int p7r_channel_try_send(struct p7r_channel *channel, const void *element) {
+    return p7r_channel_try_transfer(channel, (void *) element, P7R_CHANNEL_SEND);
+}
+
+int p7r_channel_try_recv(struct p7r_channel *channel, void *element) {
+    return p7r_channel_try_transfer(channel, element, P7R_CHANNEL_RECV);
+}
+
+struct p7r_oob_source *p7r_channel_op_send(struct p7r_channel_op *op, struct p7r_channel *channel, const void *element) {
+    return p7r_channel_op_prepare(op, channel, (void *) element, P7R_CHANNEL_SEND);
+}
+
+struct p7r_oob_source *p7r_channel_op_recv(struct p7r_channel_op *op, struct p7r_channel *channel, void *element) {
+    return p7r_channel_op_prepare(op, channel, element, P7R_CHANNEL_RECV);
+}
@@ -0,0 +1,93 @@
+#ifndef     P7R_CHANNEL_H_
+#define     P7R_CHANNEL_H_
+
+#include    "./p7r_stdc_common.h"
+#include    "./p7r_linux_common.h"
+#include    "./p7r_scraft_common.h"
+#include    "./p7r_uthread_def.h"
+
+/*
+ * Bounded multi-producer/multi-consumer channels of fixed-size elements.
+ *
+ * A full channel parks senders, an empty one parks receivers, capacity 0 makes every exchange a rendezvous.
+ * Whoever finds a parked peer completes the peer's operation on its behalf (copies the element, refills the
+ * buffer from a parked sender) before waking it, so a woken waiter never has to retry. Uthreads park in their
+ * scheduler and get woken through u2cc; OS threads sleep on a futex.
+ *
+ * A prepared p7r_channel_op is a p7r_oob_source, so one send or receive can be raced against fds and a timeout:
+ *
+ *     struct p7r_channel_op op;
+ *     struct p7r_delegation d = p7r_delegate(P7R_DELEGATION_READ|P7R_DELEGATION_ALLOW_OOB|P7R_DELEGATION_TIMED,
+ *             fd, p7r_channel_op_recv(&op, &channel, &element), (uint64_t) 100);
+ *     if (d.checked_events.oob.triggered && (op.status == P7R_CHANNEL_OP_DONE)) ...
+ */
+
+struct p7r_channel {
+    pthread_spinlock_t lock;
+    uint32_t element_size, capacity;
+    uint32_t head, n_elements;
+    char *buffer;
+    int closed;
+    list_ctl_t senders, receivers;          // parked struct p7r_channel_op
+};
+
+struct p7r_channel_op {
+    struct p7r_oob_source source;
+    struct p7r_channel *channel;
+    void *element;
+    int direction;                          // P7R_CHANNEL_SEND/RECV
+    int status;                             // P7R_CHANNEL_OP_*
+    struct p7r_delegation *delegation;      // parked uthread, NULL for an OS thread sleeping on futex
+    uint32_t futex;
+    list_ctl_t linkable;
+};
+
+#define     P7R_CHANNEL_SEND            0
+#define     P7R_CHANNEL_RECV            1
+
+#define     P7R_CHANNEL_OP_PENDING      0
+#define     P7R_CHANNEL_OP_DONE         1
+#define     P7R_CHANNEL_OP_CLOSED       2
+
+int p7r_channel_init(struct p7r_channel *channel, uint32_t element_size, uint32_t capacity);
+void p7r_channel_ruin(struct p7r_channel *channel);
+void p7r_channel_close(struct p7r_channel *channel);
+
+// 0 on success, -1 once the channel is closed (and, for receivers, drained)
+int p7r_channel_send(struct p7r_channel *channel, const void *element);
+int p7r_channel_recv(struct p7r_channel *channel, void *element);
+// never park - -1 with errno EAGAIN, or EPIPE once closed
+int p7r_channel_try_send(struct p7r_channel *channel, const void *element);
+int p7r_channel_try_recv(struct p7r_channel *channel, void *element);
+
+struct p7r_oob_source *p7r_channel_op_send(struct p7r_channel_op *op, struct p7r_channel *channel, const void *element);
+struct p7r_oob_source *p7r_channel_op_recv(struct p7r_channel_op *op, struct p7r_channel *channel, void *element);
+
+// Typed front-end: P7R_CHANNEL_TYPED(u64_channel, uint64_t) gives struct u64_channel and u64_channel_send(...) etc.
+#define     P7R_CHANNEL_TYPED(name_, type_)                                                                     \
+    struct name_ { struct p7r_channel raw; };                                                               \
+    static inline int name_##_init(struct name_ *channel, uint32_t capacity) {                              \
+        return p7r_channel_init(&(channel->raw), sizeof(type_), capacity);                                  \
+    }                                                                                                       \
+    static inline void name_##_ruin(struct name_ *channel) { p7r_channel_ruin(&(channel->raw)); }           \
+    static inline void name_##_close(struct name_ *channel) { p7r_channel_close(&(channel->raw)); }         \
+    static inline int name_##_send(struct name_ *channel, type_ element) {                                  \
+        return p7r_channel_send(&(channel->raw), &element);                                                 \
+    }                                                                                                       \
+    static inline int name_##_recv(struct name_ *channel, type_ *element) {                                 \
+        return p7r_channel_recv(&(channel->raw), element);                                                  \
+    }                                                                                                       \
+    static inline int name_##_try_send(struct name_ *channel, type_ element) {                              \
+        return p7r_channel_try_send(&(channel->raw), &element);                                             \
+    }                                                                                                       \
+    static inline int name_##_try_recv(struct name_ *channel, type_ *element) {                             \
+        return p7r_channel_try_recv(&(channel->raw), element);                                              \
+    }                                                                                                       \
+    static inline struct p7r_oob_source *name_##_op_send(struct p7r_channel_op *op, struct name_ *channel, const type_ *element) { \
+        return p7r_channel_op_send(op, &(channel->raw), element);                                           \
+    }                                                                                                       \
+    static inline struct p7r_oob_source *name_##_op_recv(struct p7r_channel_op *op, struct name_ *channel, type_ *element) {   \
+        return p7r_channel_op_recv(op, &(channel->raw), element);                                           \
+    }
+
+#endif      // P7R_CHANNEL_H_
@@ -0,0 +1,53 @@
+#ifndef     P7R_COUNTERS_H_
+#define     P7R_COUNTERS_H_
+
+#include    <stdint.h>
+
+/*
+ * Runtime counters, one block per carrier, written by that carrier only - plain stores, no atomics, and each block
+ * on cache lines of its own. Readers see every single counter whole, but no snapshot of a block as a whole.
+ *
+ * With counters.exported the blocks live in a memfd named P7R_COUNTERS_NAME, which tools/p7r_stat maps through
+ * /proc/<pid>/fd while the process keeps running. This header is all a reader needs.
+ */
+
+#define     P7R_COUNTERS_NAME           "p7r_counters"
+#define     P7R_COUNTERS_MAGIC          UINT64_C(0x7372746e756f6337)
+#define     P7R_COUNTERS_VERSION        2
+
+#define     P7R_COUNTERS_N_STACK_ZONES  3           // long-term, short-term, slaves - as P7R_STACK_ZONE_*
+#define     P7R_COUNTERS_GAUGE_PERIOD   64          // bus refreshes between two gauge updates, besides each sleep
+
+struct p7r_carrier_counters {
+    // monotonic
+    uint64_t n_switches;                // into uthreads
+    uint64_t n_bus_waits;               // epoll_wait or io_uring_enter rounds, busy polls included
+    uint64_t n_bus_sleeps;              // those which could block
+    uint64_t slept_ns;
+    uint64_t n_messages_sent;           // u2cc, by this carrier - what foreign threads post counts at the receiver only
+    uint64_t n_messages_received;
+    uint64_t n_spawned;                 // uthreads created with stacks of their own
+    uint64_t n_reincarnated;            // requests run on the stack of a finished uthread instead
+    uint64_t n_reaped;
+    uint64_t n_parks;                   // under concurrency.elastic
+    // gauges
+    uint64_t n_runnable, n_requests;
+    uint64_t stack_bytes_reserved[P7R_COUNTERS_N_STACK_ZONES];
+    uint64_t stack_bytes_committed[P7R_COUNTERS_N_STACK_ZONES];
+    uint64_t stack_bytes_resident[P7R_COUNTERS_N_STACK_ZONES];
+    uint64_t n_slaves;
+    uint64_t parked;
+    uint64_t updated_at;                // CLOCK_MONOTONIC ns of the last gauge update
+} __attribute__((aligned(64)));
+
+struct p7r_counters_segment {
+    uint64_t magic;
+    uint32_t version, n_carriers;
+    uint64_t pid;
+    struct p7r_carrier_counters carriers[];
+};
+
+#define     P7R_COUNTERS_SEGMENT_SIZE(n_carriers_)  \
+    (sizeof(struct p7r_counters_segment) + sizeof(struct p7r_carrier_counters) * (n_carriers_))
+
+#endif      // P7R_COUNTERS_H_
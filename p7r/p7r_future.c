@@ -0,0 +1,175 @@
+#include    "./p7r_future.h"
+#include    "./p7r_uthread.h"
+#include    "./p7r_root_alloc.h"
+
+#include    <limits.h>
+#include    <sys/syscall.h>
+#include    <linux/futex.h>
+
+
+// Lives on the waiting uthread's stack, or on the heap for timed waits which may leave before the post.
+// Continuations wake nobody - they are heap records with a callback instead of a delegation.
+struct p7r_future_waiter {
+    struct p7r_future_waiter *next;
+    struct p7r_delegation *delegation;
+    int claimed;            // by the poster about to wake us, or by ourselves leaving on timeout - first one wins
+    int n_references;       // heap records only, 0 otherwise
+    void (*callback)(struct p7r_future *, void *);
+    void *argument;
+};
+
+#define     P7R_FUTURE_WAITERS_CLOSED   ((struct p7r_future_waiter *) 1)
+
+static inline
+int p7r_futex(uint32_t *word, int operation, uint32_t value, const struct timespec *timeout) {
+    return (int) syscall(SYS_futex, word, operation, value, timeout, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static
+void p7r_future_waiter_unref(struct p7r_future_waiter *waiter) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    if (__atomic_sub_fetch(&(waiter->n_references), 1, __ATOMIC_ACQ_REL) == 0)
+        scraft_deallocate(allocator, waiter);
+}
+
+// Returns 0 if the future got posted meanwhile - nobody is going to wake us then.
+static
+int p7r_future_waiter_push(struct p7r_future *future, struct p7r_future_waiter *waiter) {
+    struct p7r_future_waiter *head = __atomic_load_n(&(future->waiters), __ATOMIC_ACQUIRE);
+    do {
+        if (head == P7R_FUTURE_WAITERS_CLOSED)
+            return 0;
+        waiter->next = head;
+    } while (!__atomic_compare_exchange_n(&(future->waiters), &head, waiter, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+    return 1;
+}
+
+static
+int p7r_future_os_wait(struct p7r_future *future, const struct timespec *abs_timeout) {
+    for (uint32_t spin = 0; spin < P7R_FUTURE_SPIN_TIMES; spin++) {
+        if (p7r_future_is_ready(future))
+            return 0;
+        __builtin_ia32_pause();
+    }
+    for (;;) {
+        uint32_t state = __atomic_load_n(&(future->state), __ATOMIC_ACQUIRE);
+        if (state == P7R_FUTURE_READY)
+            return 0;
+        if ((state == P7R_FUTURE_PENDING) &&
+                !__atomic_compare_exchange_n(&(future->state), &state, P7R_FUTURE_PENDING_WAITED, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            continue;
+        if (abs_timeout) {
+            if ((p7r_futex(&(future->state), FUTEX_WAIT_BITSET_PRIVATE|FUTEX_CLOCK_REALTIME, P7R_FUTURE_PENDING_WAITED, abs_timeout) == -1) &&
+                    (errno == ETIMEDOUT))
+                return p7r_future_is_ready(future) ? 0 : -1;
+        } else
+            p7r_futex(&(future->state), FUTEX_WAIT_PRIVATE, P7R_FUTURE_PENDING_WAITED, NULL);
+    }
+}
+
+static
+int p7r_future_uthread_wait(struct p7r_future *future, uint64_t timeout_ms) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    struct p7r_delegation delegation;
+    struct p7r_future_waiter waiter_local = { .n_references = 0 }, *waiter = &waiter_local;
+    if (timeout_ms && unlikely((waiter = scraft_allocate(allocator, sizeof(struct p7r_future_waiter))) == NULL))
+        return -1;
+    p7r_waiter_prepare(&delegation);
+    (waiter->delegation = &delegation), (waiter->claimed = 0), (waiter->n_references = timeout_ms ? 2 : 0);
+    (waiter->callback = NULL), (waiter->argument = NULL);
+    if (!p7r_future_waiter_push(future, waiter)) {
+        timeout_ms && (scraft_deallocate(allocator, waiter), 0);
+        return 0;
+    }
+    int ret = 0;
+    if (!p7r_waiter_park(&delegation, timeout_ms)) {
+        if (!__atomic_exchange_n(&(waiter->claimed), 1, __ATOMIC_ACQ_REL))
+            ret = -1;                                   // left for good, the record goes with the last reference
+        else
+            p7r_waiter_park(&delegation, 0);            // posted just now, the wake is on its way
+    }
+    timeout_ms && (p7r_future_waiter_unref(waiter), 0);
+    return ret;
+}
+
+int p7r_future_then(struct p7r_future *future, void (*callback)(struct p7r_future *, void *), void *argument) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    struct p7r_future_waiter *waiter = scraft_allocate(allocator, sizeof(struct p7r_future_waiter));
+    if (unlikely(waiter == NULL))
+        return -1;
+    (waiter->delegation = NULL), (waiter->claimed = 0), (waiter->n_references = 1);
+    (waiter->callback = callback), (waiter->argument = argument);
+    if (!p7r_future_waiter_push(future, waiter)) {
+        // posted already - it is ours to run
+        scraft_deallocate(allocator, waiter);
+        callback(future, argument);
+    }
+    return 0;
+}
+
+int p7r_future_init(struct p7r_future *future) {
+    (future->error_code = 0), (future->result = NULL);
+    __atomic_store_n(&(future->waiters), NULL, __ATOMIC_RELAXED);
+    __atomic_store_n(&(future->state), P7R_FUTURE_PENDING, __ATOMIC_RELEASE);
+    return 0;
+}
+
+int p7r_future_ruin(struct p7r_future *future) {
+    // only timed-out waiters may be left here, holding their own records - and continuations, dropped unrun
+    struct p7r_future_waiter *waiter = __atomic_exchange_n(&(future->waiters), NULL, __ATOMIC_ACQ_REL), *next;
+    for (; waiter && (waiter != P7R_FUTURE_WAITERS_CLOSED); waiter = next)
+        (next = waiter->next), p7r_future_waiter_unref(waiter);
+    return 0;
+}
+
+void *p7r_future_wait(struct p7r_future *future) {
+    if (!p7r_future_is_ready(future)) {
+        int ret = p7r_in_uthread() ? p7r_future_uthread_wait(future, 0) : p7r_future_os_wait(future, NULL);
+        if (ret == -1)
+            return NULL;
+    }
+    return __atomic_load_n(&(future->result), __ATOMIC_SEQ_CST);
+}
+
+void *p7r_future_trywait(struct p7r_future *future) {
+    if (!p7r_future_is_ready(future))
+        return NULL;
+    return __atomic_load_n(&(future->result), __ATOMIC_SEQ_CST);
+}
+
+void *p7r_future_timedwait(struct p7r_future *future, struct timespec abs_timeout) {
+    if (!p7r_future_is_ready(future)) {
+        int ret = -1;
+        if (p7r_in_uthread()) {
+            struct timespec current;
+            clock_gettime(CLOCK_REALTIME, &current);
+            int64_t remaining_ns = (abs_timeout.tv_sec - current.tv_sec) * 1000000000L + (abs_timeout.tv_nsec - current.tv_nsec);
+            if (remaining_ns > 0)
+                ret = p7r_future_uthread_wait(future, (remaining_ns + 999999) / 1000000);
+        } else
+            ret = p7r_future_os_wait(future, &abs_timeout);
+        if (ret == -1)
+            return NULL;
+    }
+    return __atomic_load_n(&(future->result), __ATOMIC_SEQ_CST);
+}
+
+int p7r_future_post(struct p7r_future *future) {
+    if (__atomic_exchange_n(&(future->state), P7R_FUTURE_READY, __ATOMIC_ACQ_REL) == P7R_FUTURE_PENDING_WAITED)
+        p7r_futex(&(future->state), FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+    struct p7r_future_waiter *waiter = __atomic_exchange_n(&(future->waiters), P7R_FUTURE_WAITERS_CLOSED, __ATOMIC_ACQ_REL), *next;
+    for (; waiter && (waiter != P7R_FUTURE_WAITERS_CLOSED); waiter = next) {
+        // a stack record may vanish the moment its owner is woken - read it first
+        next = waiter->next;
+        if (waiter->callback) {
+            waiter->callback(future, waiter->argument);
+            p7r_future_waiter_unref(waiter);
+            continue;
+        }
+        int on_heap = waiter->n_references != 0;
+        if (!__atomic_exchange_n(&(waiter->claimed), 1, __ATOMIC_ACQ_REL))
+            p7r_waiter_wake(waiter->delegation);
+        on_heap && (p7r_future_waiter_unref(waiter), 0);
+    }
+    return 0;
+}
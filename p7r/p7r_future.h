@@ -3,39 +3,28 @@
 
 #include    "./p7r_future_def.h"
 
+/*
+ * One-shot futures. Posting flips a lock-free state word; OS threads spin briefly on it and then sleep on it as
+ * a futex, uthreads park in their scheduler and get woken through u2cc. Nobody waiting means no syscall at all.
+ */
 
-static inline
-int p7r_future_init(struct p7r_future *future) {
-    return (future->error_code = 0), (future->result = NULL), sem_init(&(future->sync_barrier), 0, 0);
-}
-
-static inline
-int p7r_future_ruin(struct p7r_future *future) {
-    return sem_destroy(&(future->sync_barrier));
-}
-
-static inline
-void *p7r_future_wait(struct p7r_future *future) {
-    if (sem_wait(&(future->sync_barrier)) == -1) {
-        return NULL;
-    }
-    return __atomic_load_n(&(future->result), __ATOMIC_SEQ_CST);;
-}
+int p7r_future_init(struct p7r_future *future);
+int p7r_future_ruin(struct p7r_future *future);
+void *p7r_future_wait(struct p7r_future *future);
+void *p7r_future_trywait(struct p7r_future *future);
+void *p7r_future_timedwait(struct p7r_future *future, struct timespec abs_timeout);
+int p7r_future_post(struct p7r_future *future);
 
-static inline
-void *p7r_future_trywait(struct p7r_future *future) {
-    if (sem_trywait(&(future->sync_barrier)) == -1) {
-        return NULL;
-    }
-    return __atomic_load_n(&(future->result), __ATOMIC_SEQ_CST);;
-}
+/*
+ * Runs callback(future, argument) on whichever thread posts the future, or right here if it is posted already.
+ * Callbacks run in the order opposite to their registration; keep them short and never block in them.
+ * A future ruined before its post drops its continuations without running them.
+ */
+int p7r_future_then(struct p7r_future *future, void (*callback)(struct p7r_future *, void *), void *argument);
 
 static inline
-void *p7r_future_timedwait(struct p7r_future *future, struct timespec abs_timeout) {
-    if (sem_timedwait(&(future->sync_barrier), &abs_timeout) == -1) {
-        return NULL;
-    }
-    return __atomic_load_n(&(future->result), __ATOMIC_SEQ_CST);;
+int p7r_future_is_ready(struct p7r_future *future) {
+    return __atomic_load_n(&(future->state), __ATOMIC_ACQUIRE) == P7R_FUTURE_READY;
 }
 
 static inline
@@ -48,11 +37,6 @@ void p7r_future_store_result(struct p7r_future *future, void *result) {
     __atomic_store_n(&(future->result), result, __ATOMIC_SEQ_CST);
 }
 
-static inline
-int p7r_future_post(struct p7r_future *future) {
-    return sem_post(&(future->sync_barrier));
-}
-
 static inline
 int p7r_future_get_error(struct p7r_future *future) {
     return __atomic_load_n(&(future->error_code), __ATOMIC_SEQ_CST);
@@ -5,14 +5,21 @@
 #include    "./p7r_linux_common.h"
 #include    "./p7r_scraft_common.h"
 
-#include    <semaphore.h>
 
+struct p7r_future_waiter;
 
 struct p7r_future {
     void *result;
     int error_code;
-    sem_t sync_barrier;
+    uint32_t state;                         // P7R_FUTURE_*, also the futex word OS threads sleep on
+    struct p7r_future_waiter *waiters;      // parked uthreads, closed once posted
     list_ctl_t lctl;
 };
 
+#define     P7R_FUTURE_PENDING          0
+#define     P7R_FUTURE_PENDING_WAITED   1       // some OS thread may sleep on the futex - post has to wake it
+#define     P7R_FUTURE_READY            2
+
+#define     P7R_FUTURE_SPIN_TIMES       256
+
 #endif      // P7R_FUTURE_DEF_H_
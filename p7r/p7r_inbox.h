@@ -0,0 +1,70 @@
+#ifndef     P7R_INBOX_H_
+#define     P7R_INBOX_H_
+
+#include    "./p7r_stdc_common.h"
+#include    "../include/util_list.h"
+
+/*
+ * Intrusive multi-producer/single-consumer inbox, one per scheduler.
+ *
+ * Producers push onto a lock-free stack threaded through list_ctl_t::next; the consumer detaches the whole stack
+ * with one exchange and reverses it, so everything posted by a single producer comes out in posting order.
+ * A refresh costs as much as the messages actually pending, however many producers there are.
+ */
+
+struct p7r_inbox {
+    list_ctl_t *head;
+};
+
+static inline
+struct p7r_inbox *p7r_inbox_init(struct p7r_inbox *inbox) {
+    __atomic_store_n(&(inbox->head), NULL, __ATOMIC_RELEASE);
+    return inbox;
+}
+
+static inline
+int p7r_inbox_is_empty(struct p7r_inbox *inbox) {
+    return __atomic_load_n(&(inbox->head), __ATOMIC_RELAXED) == NULL;
+}
+
+// Returns non-zero if the inbox was empty before the push.
+static inline
+int p7r_inbox_push(struct p7r_inbox *inbox, list_ctl_t *product) {
+    list_ctl_t *head = __atomic_load_n(&(inbox->head), __ATOMIC_RELAXED);
+    do {
+        product->next = head;
+    } while (!__atomic_compare_exchange_n(&(inbox->head), &head, product, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return head == NULL;
+}
+
+// Pushes a chain already linked through ->next from its newest product down to its oldest one, in one go.
+static inline
+int p7r_inbox_push_chain(struct p7r_inbox *inbox, list_ctl_t *newest, list_ctl_t *oldest) {
+    list_ctl_t *head = __atomic_load_n(&(inbox->head), __ATOMIC_RELAXED);
+    do {
+        oldest->next = head;
+    } while (!__atomic_compare_exchange_n(&(inbox->head), &head, newest, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return head == NULL;
+}
+
+// Detaches everything posted so far as a raw chain, newest first - for consumers which do not care about order.
+static inline
+list_ctl_t *p7r_inbox_take(struct p7r_inbox *inbox) {
+    if (p7r_inbox_is_empty(inbox))
+        return NULL;
+    return __atomic_exchange_n(&(inbox->head), NULL, __ATOMIC_ACQUIRE);
+}
+
+// Moves everything posted so far to the tail of target in posting order, returns the number of products moved.
+static inline
+uint32_t p7r_inbox_drain(struct p7r_inbox *inbox, list_ctl_t *target) {
+    list_ctl_t *iterator = p7r_inbox_take(inbox), *reversed = NULL, *next;
+    uint32_t n_products = 0;
+    for (; iterator; iterator = next, n_products++)
+        (next = iterator->next), (iterator->next = reversed), (reversed = iterator);
+    for (; reversed; reversed = next)
+        (next = reversed->next), list_add_tail(reversed, target);
+    return n_products;
+}
+
+#endif      // P7R_INBOX_H_
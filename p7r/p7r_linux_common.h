@@ -12,6 +12,8 @@
 #include    <sys/eventfd.h>
 #include    <sys/uio.h>
 #include    <sys/mman.h>
+#include    <sys/socket.h>
+#include    <poll.h>
 
 
 #endif      // P7R_LINUX_COMMON_H_
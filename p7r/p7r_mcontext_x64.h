@@ -12,7 +12,8 @@
 #define     p7r_mcontext                p7r_mcontext_x64
 
 #define     p7r_mcontext_init           p7r_mcontext_x64_init
-#define     p7r_mcontext_switch         p7r_mcontext_x64_switch
+#define     p7r_mcontext_switch         p7r_mcontext_x64_swap
+#define     p7r_mcontext_switch_full    p7r_mcontext_x64_switch
 #define     p7r_mcontext_stack_base     p7r_mcontext_x64_stack_base
 
 #include    "./p7r_stdc_common.h"
@@ -24,6 +25,10 @@
  * It is up to the wrapper to decide how to escape since no context could easily self-destruct, but
  * know that
  * no one lives forever.
+ *
+ * Contexts are switched at call boundaries, so p7r_mcontext_x64_swap keeps callee-saved registers, MXCSR and the
+ * x87 control word only. p7r_mcontext_x64_switch still saves everything; both can enter a fresh context, which
+ * starts through a trampoline taking the entrance from r12 and its argument from r13.
  */
 
 struct p7r_mcontext_x64 {
@@ -31,9 +36,12 @@ struct p7r_mcontext_x64 {
     uint64_t rsp, rbp;
     uint64_t r11, r12, r13, r14, r15;
     uint64_t rip;
+    uint32_t mxcsr;
+    uint16_t fpucw;
 } __attribute__((packed));
 
 void p7r_mcontext_x64_init(struct p7r_mcontext_x64 *mcontext, void (*entrance)(void *), void *argument, void *stack_base_real);
+void p7r_mcontext_x64_swap(struct p7r_mcontext_x64 *to, struct p7r_mcontext_x64 *from);
 void p7r_mcontext_x64_switch(struct p7r_mcontext_x64 *to, struct p7r_mcontext_x64 *from);
 
 static inline
@@ -0,0 +1,114 @@
+#include    "./p7r_message_slab.h"
+#include    "./p7r_root_alloc.h"
+
+
+struct p7r_message_slab_chunk {
+    list_ctl_t linkable;
+    char blocks[] __attribute__((aligned(16)));
+};
+
+#define     P7R_MESSAGE_SLAB_CHUNK_SIZE     \
+    (sizeof(struct p7r_message_slab_chunk) + P7R_MESSAGE_SLAB_BLOCK_SIZE * P7R_MESSAGE_SLAB_CHUNK_BLOCKS)
+
+static
+int p7r_message_slab_grow(struct p7r_message_slab *slab) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    struct p7r_message_slab_chunk *chunk = (slab->numa_node == P7R_NUMA_ANYWHERE) ?
+        scraft_allocate(allocator, P7R_MESSAGE_SLAB_CHUNK_SIZE) : p7r_numa_map(P7R_MESSAGE_SLAB_CHUNK_SIZE, slab->numa_node);
+    if (unlikely(chunk == NULL))
+        return -1;
+    list_add_tail(&(chunk->linkable), &(slab->chunks));
+    for (uint32_t block_index = 0; block_index < P7R_MESSAGE_SLAB_CHUNK_BLOCKS; block_index++)
+        list_add_tail((list_ctl_t *) (chunk->blocks + block_index * P7R_MESSAGE_SLAB_BLOCK_SIZE), &(slab->free_blocks));
+    p7r_message_slab_count(slab, n_chunks);
+    return 0;
+}
+
+static
+int p7r_message_slab_reclaim(struct p7r_message_slab *slab) {
+    list_ctl_t *iterator = p7r_inbox_take(&(slab->returned)), *next;
+    int n_reclaimed = 0;
+    for (; iterator; iterator = next, n_reclaimed++)
+        (next = iterator->next), list_add_tail(iterator, &(slab->free_blocks));
+    __atomic_store_n(&(slab->stat.n_reclaimed), slab->stat.n_reclaimed + n_reclaimed, __ATOMIC_RELAXED);
+    return n_reclaimed;
+}
+
+static
+void p7r_message_slab_return(struct p7r_message_slab *local, struct p7r_message_slab_return *pending) {
+    p7r_inbox_push_chain(&(pending->origin->returned), pending->newest, pending->oldest);
+    (pending->newest = pending->oldest = NULL), (pending->n_blocks = 0);
+    list_del(&(pending->dirty_link));
+    p7r_message_slab_count(local, n_return_batches);
+}
+
+struct p7r_message_slab *p7r_message_slab_init(struct p7r_message_slab *slab, uint32_t index, uint32_t n_peers, uint32_t numa_node) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    (slab->index = index), (slab->n_peers = n_peers), (slab->numa_node = numa_node);
+    init_list_head(&(slab->free_blocks));
+    init_list_head(&(slab->chunks));
+    init_list_head(&(slab->pending_dirty));
+    p7r_inbox_init(&(slab->returned));
+    memset(&(slab->stat), 0, sizeof(struct p7r_message_slab_stat));
+    if (unlikely((slab->pending = scraft_allocate(allocator, sizeof(struct p7r_message_slab_return) * n_peers)) == NULL))
+        return NULL;
+    for (uint32_t peer_index = 0; peer_index < n_peers; peer_index++) {
+        (slab->pending[peer_index].newest = slab->pending[peer_index].oldest = NULL), (slab->pending[peer_index].n_blocks = 0);
+        slab->pending[peer_index].origin = NULL;
+        list_node_isolate(&(slab->pending[peer_index].dirty_link));
+    }
+    return slab;
+}
+
+void p7r_message_slab_ruin(struct p7r_message_slab *slab) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    list_ctl_t *p, *t;
+    list_foreach_remove(p, &(slab->chunks), t) {
+        list_del(t);
+        struct p7r_message_slab_chunk *chunk = container_of(t, struct p7r_message_slab_chunk, linkable);
+        if (slab->numa_node == P7R_NUMA_ANYWHERE)
+            scraft_deallocate(allocator, chunk);
+        else
+            p7r_numa_unmap(chunk, P7R_MESSAGE_SLAB_CHUNK_SIZE);
+    }
+    scraft_deallocate(allocator, slab->pending);
+}
+
+void *p7r_message_slab_allocate(struct p7r_message_slab *slab) {
+    if (unlikely(list_is_empty(&(slab->free_blocks))))
+        if ((p7r_message_slab_reclaim(slab) == 0) && (p7r_message_slab_grow(slab) == -1))
+            return NULL;
+    list_ctl_t *block = slab->free_blocks.next;
+    list_del(block);
+    p7r_message_slab_count(slab, n_allocated);
+    return block;
+}
+
+void p7r_message_slab_free(struct p7r_message_slab *local, struct p7r_message_slab *origin, void *block_) {
+    list_ctl_t *block = block_;
+    if (local == origin) {
+        list_add_head(block, &(local->free_blocks));
+        p7r_message_slab_count(local, n_freed_local);
+        return;
+    }
+    if (local == NULL) {
+        // not on a carrier - nothing to batch with
+        p7r_inbox_push(&(origin->returned), block);
+        return;
+    }
+    struct p7r_message_slab_return *pending = &(local->pending[origin->index]);
+    if (pending->n_blocks++ == 0) {
+        (pending->oldest = block), (pending->origin = origin);
+        list_add_tail(&(pending->dirty_link), &(local->pending_dirty));
+    }
+    (block->next = pending->newest), (pending->newest = block);
+    p7r_message_slab_count(local, n_freed_remote);
+    if (pending->n_blocks >= P7R_MESSAGE_SLAB_RETURN_BATCH)
+        p7r_message_slab_return(local, pending);
+}
+
+void p7r_message_slab_flush(struct p7r_message_slab *local) {
+    list_ctl_t *p, *t;
+    list_foreach_remove(p, &(local->pending_dirty), t)
+        p7r_message_slab_return(local, container_of(t, struct p7r_message_slab_return, dirty_link));
+}
@@ -0,0 +1,59 @@
+#ifndef     P7R_MESSAGE_SLAB_H_
+#define     P7R_MESSAGE_SLAB_H_
+
+#include    "./p7r_stdc_common.h"
+#include    "./p7r_linux_common.h"
+#include    "./p7r_scraft_common.h"
+#include    "./p7r_inbox.h"
+#include    "./p7r_numa.h"
+
+/*
+ * Per-scheduler slab of fixed-size blocks for internal messages.
+ *
+ * Only the owner allocates. A block freed by another carrier is kept aside and handed back to its origin in
+ * batches through the origin's return inbox, so the spawn path never touches the root allocator, and no two
+ * carriers ever fight over the same free list.
+ */
+
+#define     P7R_MESSAGE_SLAB_BLOCK_SIZE     192
+#define     P7R_MESSAGE_SLAB_CHUNK_BLOCKS   256
+#define     P7R_MESSAGE_SLAB_RETURN_BATCH   32
+
+struct p7r_message_slab_stat {
+    uint64_t n_allocated;           // served by the slab
+    uint64_t n_bypassed;            // too big for a block, went to the root allocator
+    uint64_t n_chunks;              // root allocations made by the slab itself
+    uint64_t n_freed_local;
+    uint64_t n_freed_remote;        // blocks of other slabs we freed and sent back
+    uint64_t n_return_batches;
+    uint64_t n_reclaimed;           // blocks we got back from other slabs
+};
+
+struct p7r_message_slab_return {
+    struct p7r_message_slab *origin;
+    list_ctl_t *newest, *oldest;
+    uint32_t n_blocks;
+    list_ctl_t dirty_link;
+};
+
+struct p7r_message_slab {
+    uint32_t index, n_peers;
+    uint32_t numa_node;                 // chunks get mapped on it, P7R_NUMA_ANYWHERE takes them from the root allocator
+    list_ctl_t free_blocks, chunks;
+    struct p7r_inbox returned;
+    struct p7r_message_slab_return *pending;
+    list_ctl_t pending_dirty;
+    struct p7r_message_slab_stat stat;
+};
+
+struct p7r_message_slab *p7r_message_slab_init(struct p7r_message_slab *slab, uint32_t index, uint32_t n_peers, uint32_t numa_node);
+void p7r_message_slab_ruin(struct p7r_message_slab *slab);
+
+void *p7r_message_slab_allocate(struct p7r_message_slab *slab);
+void p7r_message_slab_free(struct p7r_message_slab *local, struct p7r_message_slab *origin, void *block);
+void p7r_message_slab_flush(struct p7r_message_slab *local);
+
+#define     p7r_message_slab_count(slab_, counter_)     \
+    __atomic_store_n(&((slab_)->stat.counter_), (slab_)->stat.counter_ + 1, __ATOMIC_RELAXED)
+
+#endif      // P7R_MESSAGE_SLAB_H_
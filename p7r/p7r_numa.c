@@ -0,0 +1,48 @@
+#define     _GNU_SOURCE
+#include    "./p7r_numa.h"
+
+#include    <stdio.h>
+#include    <dirent.h>
+#include    <sys/syscall.h>
+#include    <linux/mempolicy.h>
+
+
+#define     P7R_NUMA_MAX_NODES          1024
+
+uint32_t p7r_numa_node_of_cpu(uint32_t cpu) {
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+    DIR *directory = opendir(path);
+    if (directory == NULL)
+        return P7R_NUMA_ANYWHERE;
+    uint32_t node = P7R_NUMA_ANYWHERE;
+    struct dirent *entry;
+    while ((node == P7R_NUMA_ANYWHERE) && ((entry = readdir(directory)) != NULL)) {
+        unsigned index;
+        (sscanf(entry->d_name, "node%u", &index) == 1) && (index < P7R_NUMA_MAX_NODES) && (node = index + 1);
+    }
+    closedir(directory);
+    return node;
+}
+
+int p7r_numa_prefer(void *address, size_t size, uint32_t node) {
+    if ((node == P7R_NUMA_ANYWHERE) || (node > P7R_NUMA_MAX_NODES))
+        return 0;
+    unsigned long mask[P7R_NUMA_MAX_NODES / (8 * sizeof(unsigned long))] = { 0 };
+    mask[(node - 1) / (8 * sizeof(unsigned long))] |= 1UL << ((node - 1) % (8 * sizeof(unsigned long)));
+    // maxnode counts one past the last bit, as the kernel drops the last one
+    return (int) syscall(SYS_mbind, address, size, MPOL_PREFERRED, mask, P7R_NUMA_MAX_NODES + 1, 0);
+}
+
+void *p7r_numa_map(size_t size, uint32_t node) {
+    void *address = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if (address == MAP_FAILED)
+        return NULL;
+    // a single node box or a kernel without NUMA just gets the pages from anywhere
+    p7r_numa_prefer(address, size, node);
+    return address;
+}
+
+void p7r_numa_unmap(void *address, size_t size) {
+    (address) && (munmap(address, size), 0);
+}
@@ -0,0 +1,24 @@
+#ifndef     P7R_NUMA_H_
+#define     P7R_NUMA_H_
+
+#include    "./p7r_stdc_common.h"
+#include    "./p7r_linux_common.h"
+
+/*
+ * Just enough NUMA for carriers, without libnuma: the node of a CPU comes from sysfs, placement goes through mbind(2)
+ * with a preferred node, so that memory still comes from elsewhere when the node runs dry.
+ *
+ * Nodes are passed around as node + 1, 0 meaning wherever the kernel likes.
+ */
+
+#define     P7R_NUMA_ANYWHERE           0
+
+uint32_t p7r_numa_node_of_cpu(uint32_t cpu);
+
+// for pages not touched yet - those already there stay where they are
+int p7r_numa_prefer(void *address, size_t size, uint32_t node);
+
+void *p7r_numa_map(size_t size, uint32_t node);
+void p7r_numa_unmap(void *address, size_t size);
+
+#endif      // P7R_NUMA_H_
@@ -2,32 +2,47 @@
 #include    "./p7r_root_alloc.h"
 
 
+// single writer - the owning scheduler; readers elsewhere just want a torn-free value
+#define     p7r_stack_zone_count(provider_, counter_, delta_)   \
+    __atomic_store_n(&((provider_)->stat->counter_), (provider_)->stat->counter_ + (delta_), __ATOMIC_RELAXED)
+
+#define     p7r_stack_bytes_user(provider_)     \
+    ((uint64_t) (provider_)->n_bytes_page * (provider_)->size_class->n_pages_stack_user)
+
 static
 struct p7r_stack_page_provider *p7r_stack_page_provider_init(
         struct p7r_stack_page_provider *provider, 
         uint32_t type,
         uint32_t n_pages_capacity, 
-        uint32_t n_pages_stack,
+        struct p7r_stack_size_class *size_class,
         uint32_t n_bytes_page,
         struct p7r_stack_allocator *parent
     ) {
+    uint32_t n_pages_stack = size_class->n_pages_stack_total;
     // provider->total_size is just some read-only hint
     if (unlikely(__builtin_mul_overflow(n_pages_capacity, n_bytes_page, &(provider->total_size)))) {
         provider->zone = NULL;
         return NULL;
     }
 
-    provider->zone = mmap(NULL, provider->total_size, PROT_READ|PROT_WRITE|PROT_EXEC, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    // nothing ever runs from a stack - no PROT_EXEC
+    provider->zone = mmap(NULL, provider->total_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
     if (provider->zone == MAP_FAILED) {
         provider->zone = NULL;
         return NULL;
     }
+    p7r_numa_prefer(provider->zone, provider->total_size, parent->properties.numa_node);
 
     provider->size = provider->capacity = n_pages_capacity;
     provider->n_bytes_page = n_bytes_page;
     provider->type = type;
-    provider->parent = parent;
+    (provider->parent = parent), (provider->size_class = size_class);
     init_list_head(&(provider->pages));
+    init_list_head(&(provider->clean_pages));
+    provider->n_dirty = 0;
+    memset(&(provider->own_stat), 0, sizeof(struct p7r_stack_zone_stat));
+    provider->stat = (type == P7R_STACK_ALLOCATOR_SLAVE) ? &(size_class->slaves.stat) : &(provider->own_stat);
+    p7r_stack_zone_count(provider, n_bytes_reserved, provider->total_size);
 
     void *stack_page_iterator = provider->zone;
     for (
@@ -36,7 +51,7 @@ struct p7r_stack_page_provider *p7r_stack_page_provider_init(
          n_pages_initialized += n_pages_stack, stack_page_iterator += (n_pages_stack * n_bytes_page)
         ) {
         struct p7r_stack_metamark *mark = stack_page_iterator;
-        list_add_tail(&(mark->linkable), &(provider->pages));
+        list_add_tail(&(mark->linkable), &(provider->clean_pages));
         mark->provider = provider;
         mark->n_bytes_page = n_bytes_page;
         mark->red_zone_addr = stack_page_iterator + n_bytes_page;
@@ -51,6 +66,8 @@ static
 struct p7r_stack_page_provider *p7r_stack_page_provider_ruin(struct p7r_stack_page_provider *provider) {
     if (provider->zone) {
         munmap(provider->zone, provider->total_size);
+        p7r_stack_zone_count(provider, n_bytes_reserved, -(uint64_t) provider->total_size);
+        p7r_stack_zone_count(provider, n_bytes_resident, -(provider->n_dirty * p7r_stack_bytes_user(provider)));
     }
     return provider;
 }
@@ -59,7 +76,7 @@ static
 struct p7r_stack_page_provider *p7r_stack_page_provider_new(
         uint32_t type,
         uint32_t n_pages_capacity, 
-        uint32_t n_pages_stack, 
+        struct p7r_stack_size_class *size_class, 
         uint32_t n_bytes_page,
         struct p7r_stack_allocator *parent
     ) {
@@ -67,7 +84,7 @@ struct p7r_stack_page_provider *p7r_stack_page_provider_new(
     struct p7r_stack_page_provider *provider = scraft_allocate(allocator, sizeof(struct p7r_stack_page_provider));
 
     if (provider) {
-        if (unlikely(p7r_stack_page_provider_init(provider, type, n_pages_capacity, n_pages_stack, n_bytes_page, parent) == NULL)) {
+        if (unlikely(p7r_stack_page_provider_init(provider, type, n_pages_capacity, size_class, n_bytes_page, parent) == NULL)) {
             scraft_deallocate(allocator, provider);
             return NULL;
         }
@@ -86,6 +103,7 @@ static inline
 void p7r_stack_page_slaver_init(struct p7r_stack_page_slaver *slaver) {
     slaver->n_slaves = 0;
     init_list_head(&(slaver->slaves));
+    memset(&(slaver->stat), 0, sizeof(struct p7r_stack_zone_stat));
 }
 
 struct p7r_stack_metamark *p7r_stack_page_allocate(struct p7r_stack_page_provider *provider) {
@@ -95,11 +113,23 @@ struct p7r_stack_metamark *p7r_stack_page_allocate(struct p7r_stack_page_provide
         return NULL;
     }
 
-    list_ctl_t *target_link = provider->pages.next;
+    // a dirty stack costs no page faults - the most recently freed one is the warmest
+    list_ctl_t *target_link;
+    int clean = !provider->n_dirty;
+    if (!clean)
+        (target_link = provider->pages.next), (provider->n_dirty--);
+    else {
+        target_link = provider->clean_pages.next;
+        p7r_stack_zone_count(provider, n_bytes_resident, p7r_stack_bytes_user(provider));
+    }
     list_del(target_link);
-    provider->size -= provider->parent->properties.n_pages_stack_total;
+    provider->size -= provider->size_class->n_pages_stack_total;
     target = container_of(target_link, struct p7r_stack_metamark, linkable);
     target->n_bytes_page = provider->n_bytes_page;
+    // a dirty stack got repainted by its last user as far as it went down
+    if (unlikely(provider->parent->properties.high_water_profile) && clean)
+        p7r_stack_paint(target->raw_content_addr, target->raw_content_addr + p7r_stack_bytes_user(provider));
+    p7r_stack_zone_count(provider, n_bytes_committed, p7r_stack_bytes_user(provider));
 
     return target;
 }
@@ -110,14 +140,14 @@ int p7r_slave_free_adjust(struct p7r_stack_page_provider *slave) {
     int dying = 0;
 
     if (!dummy_size) {
-        struct p7r_stack_page_provider *compared = container_of(slave->parent->slaves.slaves.next, struct p7r_stack_page_provider, linkable);
+        struct p7r_stack_page_provider *compared = container_of(slave->size_class->slaves.slaves.next, struct p7r_stack_page_provider, linkable);
         if (compared != slave) {
             list_del(&(slave->linkable));
-            list_add_head(&(slave->linkable), &(slave->parent->slaves.slaves));
+            list_add_head(&(slave->linkable), &(slave->size_class->slaves.slaves));
         }
     }
 
-    dummy_size += slave->parent->properties.n_pages_stack_total;
+    dummy_size += slave->size_class->n_pages_stack_total;
 
     if (dummy_size == slave->capacity) {
         list_del(&(slave->linkable));
@@ -131,35 +161,60 @@ static
 int p7r_slave_allocation_adjust(struct p7r_stack_page_provider *slave) {
     if (slave->size == 0) {
         list_del(&(slave->linkable));
-        list_add_tail(&(slave->linkable), &(slave->parent->slaves.slaves));
+        list_add_tail(&(slave->linkable), &(slave->size_class->slaves.slaves));
     }
 }
 
+// Gives the pages of the coldest dirty stack back to the kernel, its metadata page stays.
+static
+void p7r_stack_page_reclaim(struct p7r_stack_page_provider *provider) {
+    struct p7r_stack_allocator_config *properties = &(provider->parent->properties);
+    struct p7r_stack_metamark *mark = container_of(provider->pages.prev, struct p7r_stack_metamark, linkable);
+    uint64_t n_bytes = p7r_stack_bytes_user(provider);
+
+    // MADV_FREE needs 4.5+, fall back for good
+    if ((properties->reclaim_advice == P7R_STACK_RECLAIM_FREE) && (madvise(mark->raw_content_addr, n_bytes, MADV_FREE) == -1))
+        properties->reclaim_advice = P7R_STACK_RECLAIM_DONTNEED;
+    if (properties->reclaim_advice == P7R_STACK_RECLAIM_DONTNEED)
+        madvise(mark->raw_content_addr, n_bytes, MADV_DONTNEED);
+
+    list_del(P7R_STACK_METAMARK_LINK_OF(mark));
+    list_add_head(P7R_STACK_METAMARK_LINK_OF(mark), &(provider->clean_pages));
+    provider->n_dirty--;
+    p7r_stack_zone_count(provider, n_bytes_resident, -n_bytes);
+    p7r_stack_zone_count(provider, n_bytes_reclaimed, n_bytes);
+    p7r_stack_zone_count(provider, n_reclaims, 1);
+}
+
 void p7r_stack_page_free(struct p7r_stack_metamark *mark) {
     struct p7r_stack_page_provider *provider = mark->provider;
 
-    // we don't care anything about sequence of stacks for they are all the same
+    // LIFO, so that the stacks still hot in cache get reused first
     list_add_head(&(mark->linkable), &(provider->pages));
+    provider->n_dirty++;
+    p7r_stack_zone_count(provider, n_bytes_committed, -p7r_stack_bytes_user(provider));
+    if (provider->n_dirty > provider->parent->properties.reclaim_watermark)
+        p7r_stack_page_reclaim(provider);
 
     if (provider->type == P7R_STACK_ALLOCATOR_SLAVE) {
         if (p7r_slave_free_adjust(provider)) {
-            provider->parent->slaves.n_slaves--;
+            provider->size_class->slaves.n_slaves--;
             p7r_stack_page_provider_delete(provider);
             return;
         }
     }
-    provider->size += provider->parent->properties.n_pages_stack_total;
+    provider->size += provider->size_class->n_pages_stack_total;
 }
 
 // TODO refactor: remove hard-coded pipeline
 
-struct p7r_stack_metamark *p7r_stack_page_allocate_fallback(struct p7r_stack_allocator *allocator) {
+struct p7r_stack_metamark *p7r_stack_page_allocate_fallback(struct p7r_stack_size_class *size_class) {
     struct p7r_stack_metamark *result = NULL;
-    struct p7r_stack_page_slaver *slaver = &(allocator->slaves);
+    struct p7r_stack_allocator *allocator = size_class->long_term.parent;
     struct p7r_stack_page_provider *target_slave = NULL;
 
     list_ctl_t *slave_iterator;
-    list_foreach(slave_iterator, &(allocator->slaves.slaves)) {
+    list_foreach(slave_iterator, &(size_class->slaves.slaves)) {
         struct p7r_stack_page_provider *slave = container_of(slave_iterator, struct p7r_stack_page_provider, linkable);
         if (slave->size) {
             target_slave = slave;
@@ -171,13 +226,13 @@ struct p7r_stack_metamark *p7r_stack_page_allocate_fallback(struct p7r_stack_all
         target_slave = 
             p7r_stack_page_provider_new(
                     P7R_STACK_ALLOCATOR_SLAVE, 
-                    allocator->properties.n_pages_slave, 
-                    allocator->properties.n_pages_stack_total, 
+                    size_class->n_pages_slave, 
+                    size_class, 
                     allocator->properties.n_bytes_page,
                     allocator
             );
-        list_add_head(&(target_slave->linkable), &(allocator->slaves.slaves));
-        allocator->slaves.n_slaves++;
+        list_add_head(&(target_slave->linkable), &(size_class->slaves.slaves));
+        size_class->slaves.n_slaves++;
     }
     result = p7r_stack_page_allocate(target_slave);
     p7r_slave_allocation_adjust(target_slave);      // demote an empty slave
@@ -186,23 +241,23 @@ struct p7r_stack_metamark *p7r_stack_page_allocate_fallback(struct p7r_stack_all
 }
 
 static
-struct p7r_stack_metamark *p7r_stack_page_allocate_long_term(struct p7r_stack_allocator *allocator) {
+struct p7r_stack_metamark *p7r_stack_page_allocate_long_term(struct p7r_stack_size_class *size_class) {
     struct p7r_stack_metamark *result = NULL;
-    struct p7r_stack_page_provider *self = &(allocator->long_term);
+    struct p7r_stack_page_provider *self = &(size_class->long_term);
 
     if ((result = p7r_stack_page_allocate(self)) == NULL)
-        result = p7r_stack_page_allocate_fallback(allocator);
+        result = p7r_stack_page_allocate_fallback(size_class);
 
     return result;
 }
 
 static
-struct p7r_stack_metamark *p7r_stack_page_allocate_short_term(struct p7r_stack_allocator *allocator) {
+struct p7r_stack_metamark *p7r_stack_page_allocate_short_term(struct p7r_stack_size_class *size_class) {
     struct p7r_stack_metamark *result = NULL;
-    struct p7r_stack_page_provider *self = &(allocator->short_term);
+    struct p7r_stack_page_provider *self = &(size_class->short_term);
 
     if ((result = p7r_stack_page_allocate(self)) == NULL)
-        result = p7r_stack_page_allocate_long_term(allocator);
+        result = p7r_stack_page_allocate_long_term(size_class);
 
     return result;
 }
@@ -211,78 +266,223 @@ static
 struct p7r_stack_allocator_config p7r_stack_allocator_config_adjust(struct p7r_stack_allocator_config *config_) {
     __auto_type config = *config_;
     config.n_pages_stack_user = config.n_pages_stack_total - 2;
-#define adjust_capacity(capacity_) \
+#define adjust_capacity(capacity_, n_pages_stack_) \
+    do { \
+        if ((capacity_) % (n_pages_stack_)) \
+            (capacity_) = (capacity_) - (capacity_) % (n_pages_stack_) + (n_pages_stack_); \
+    } while (0)
+#define scale_capacity(capacity_, n_pages_stack_, default_capacity_) \
     do { \
-        if ((capacity_) % config.n_pages_stack_total) \
-            (capacity_) = (capacity_) - (capacity_) % config.n_pages_stack_total + config.n_pages_stack_total; \
+        ((capacity_) == 0) && ((capacity_) = (default_capacity_) / config.n_pages_stack_total * (n_pages_stack_)); \
+        adjust_capacity(capacity_, n_pages_stack_); \
     } while (0)
-    adjust_capacity(config.n_pages_short_term);
-    adjust_capacity(config.n_pages_long_term);
-    adjust_capacity(config.n_pages_slave);
+    adjust_capacity(config.n_pages_short_term, config.n_pages_stack_total);
+    adjust_capacity(config.n_pages_long_term, config.n_pages_stack_total);
+    adjust_capacity(config.n_pages_slave, config.n_pages_stack_total);
+    (config.reclaim_watermark == 0) && (config.reclaim_watermark = P7R_STACK_RECLAIM_DEFAULT_WATERMARK);
+    // a class needs its metadata page, a red zone and something to run on - the rest is not looked at
+    (config.n_extra_size_classes > P7R_STACK_MAX_SIZE_CLASSES - 1) && (config.n_extra_size_classes = P7R_STACK_MAX_SIZE_CLASSES - 1);
+    for (uint32_t index = 0; index < config.n_extra_size_classes; index++) {
+        struct p7r_stack_size_class_config *size_class = &(config.size_classes[index]);
+        if (size_class->n_pages_stack_total < 3) {
+            config.n_extra_size_classes = index;
+            break;
+        }
+        scale_capacity(size_class->n_pages_short_term, size_class->n_pages_stack_total, config.n_pages_short_term);
+        scale_capacity(size_class->n_pages_long_term, size_class->n_pages_stack_total, config.n_pages_long_term);
+        scale_capacity(size_class->n_pages_slave, size_class->n_pages_stack_total, config.n_pages_slave);
+    }
     return config;
+#undef scale_capacity
 #undef adjust_capacity
 }
 
-double p7r_stack_allocator_usage(struct p7r_stack_allocator *allocator) {
-    return ((double) allocator->short_term.size) / ((double) allocator->short_term.capacity);
-}
-
-struct p7r_stack_allocator *p7r_stack_allocator_init(struct p7r_stack_allocator *allocator, struct p7r_stack_allocator_config config) {
-    allocator->properties = p7r_stack_allocator_config_adjust(&config);
-    p7r_stack_page_slaver_init(&(allocator->slaves));
+static
+struct p7r_stack_size_class *p7r_stack_size_class_init(
+        struct p7r_stack_size_class *size_class,
+        uint32_t index,
+        struct p7r_stack_size_class_config config,
+        struct p7r_stack_allocator *parent
+    ) {
+    size_class->index = index;
+    (size_class->n_pages_stack_total = config.n_pages_stack_total), (size_class->n_pages_stack_user = config.n_pages_stack_total - 2);
+    (size_class->n_pages_long_term = config.n_pages_long_term), (size_class->n_pages_short_term = config.n_pages_short_term);
+    size_class->n_pages_slave = config.n_pages_slave;
+    p7r_stack_page_slaver_init(&(size_class->slaves));
 
     p7r_stack_page_provider_init(
-            &(allocator->long_term),
+            &(size_class->long_term),
             P7R_STACK_ALLOCATOR_MASTER, 
-            allocator->properties.n_pages_long_term, 
-            allocator->properties.n_pages_stack_total, 
-            allocator->properties.n_bytes_page, 
-            allocator
+            size_class->n_pages_long_term, 
+            size_class, 
+            parent->properties.n_bytes_page, 
+            parent
     );
     p7r_stack_page_provider_init(
-            &(allocator->short_term),
+            &(size_class->short_term),
             P7R_STACK_ALLOCATOR_MASTER, 
-            allocator->properties.n_pages_short_term, 
-            allocator->properties.n_pages_stack_total, 
-            allocator->properties.n_bytes_page, 
-            allocator
+            size_class->n_pages_short_term, 
+            size_class, 
+            parent->properties.n_bytes_page, 
+            parent
     );
 
-    void safe_deleter(struct p7r_stack_page_provider *provider) {
-        if(provider)
-            p7r_stack_page_provider_ruin(provider);
-    }
-
-    if ((allocator->long_term.zone == NULL) || (allocator->short_term.zone == NULL)) {
-        safe_deleter(&(allocator->long_term));
-        safe_deleter(&(allocator->short_term));
+    if ((size_class->long_term.zone == NULL) || (size_class->short_term.zone == NULL)) {
+        p7r_stack_page_provider_ruin(&(size_class->long_term));
+        p7r_stack_page_provider_ruin(&(size_class->short_term));
         return NULL;
     }
 
-    return allocator;
+    return size_class;
 }
 
-void p7r_stack_allocator_ruin(struct p7r_stack_allocator *allocator) {
-    p7r_stack_page_provider_ruin(&(allocator->long_term));
-    p7r_stack_page_provider_ruin(&(allocator->short_term));
+static
+void p7r_stack_size_class_ruin(struct p7r_stack_size_class *size_class) {
+    p7r_stack_page_provider_ruin(&(size_class->long_term));
+    p7r_stack_page_provider_ruin(&(size_class->short_term));
 
     list_ctl_t *iterator_forward, *iterator_actual;
-    list_foreach_remove(iterator_forward, &(allocator->slaves.slaves), iterator_actual) {
+    list_foreach_remove(iterator_forward, &(size_class->slaves.slaves), iterator_actual) {
         list_del(iterator_actual);
         struct p7r_stack_page_provider *slave = container_of(iterator_actual, struct p7r_stack_page_provider, linkable);
         p7r_stack_page_provider_delete(slave);
     }
 }
 
-struct p7r_stack_metamark *p7r_stack_allocate(int type, struct p7r_stack_allocator *allocator) {
+struct p7r_stack_size_class *p7r_stack_size_class_of(struct p7r_stack_allocator *allocator, uint32_t size_class) {
+    return &(allocator->size_classes[(size_class < allocator->n_size_classes) ? size_class : P7R_STACK_CLASS_DEFAULT]);
+}
+
+uint32_t p7r_stack_size_class_fit(struct p7r_stack_allocator *allocator, uint64_t n_bytes) {
+    uint32_t fit = UINT32_MAX, biggest = P7R_STACK_CLASS_DEFAULT;
+    for (uint32_t index = 0; index < allocator->n_size_classes; index++) {
+        uint32_t n_pages = allocator->size_classes[index].n_pages_stack_user;
+        (n_pages > allocator->size_classes[biggest].n_pages_stack_user) && (biggest = index);
+        if (((uint64_t) n_pages * allocator->properties.n_bytes_page >= n_bytes) &&
+                ((fit == UINT32_MAX) || (n_pages < allocator->size_classes[fit].n_pages_stack_user)))
+            fit = index;
+    }
+    return (fit == UINT32_MAX) ? biggest : fit;
+}
+
+void p7r_stack_paint(char *from, char *to) {
+    for (uint64_t *word = (uint64_t *) from; word < (uint64_t *) to; word++)
+        *word = P7R_STACK_CANARY;
+}
+
+// Lowest address a painted stack has been written to since painting - its top when untouched.
+char *p7r_stack_deepest(struct p7r_stack_metamark *mark) {
+    uint64_t *word = (uint64_t *) mark->raw_content_addr, *top = (uint64_t *) (mark->raw_content_addr + p7r_stack_bytes_of(mark));
+    while ((word < top) && (*word == P7R_STACK_CANARY))
+        word++;
+    return (char *) word;
+}
+
+double p7r_stack_allocator_usage(struct p7r_stack_allocator *allocator) {
+    struct p7r_stack_page_provider *short_term = &(allocator->size_classes[P7R_STACK_CLASS_DEFAULT].short_term);
+    return ((double) short_term->size) / ((double) short_term->capacity);
+}
+
+static
+void p7r_stack_zone_stat_add(struct p7r_stack_zone_stat *stat, struct p7r_stack_size_class *size_class, uint32_t zone) {
+    struct p7r_stack_zone_stat *source;
+    switch (zone) {
+        case P7R_STACK_ZONE_LONG_TERM:
+            source = &(size_class->long_term.own_stat);
+            break;
+        case P7R_STACK_ZONE_SHORT_TERM:
+            source = &(size_class->short_term.own_stat);
+            break;
+        default:
+            source = &(size_class->slaves.stat);
+    }
+    stat->n_bytes_reserved += __atomic_load_n(&(source->n_bytes_reserved), __ATOMIC_RELAXED);
+    stat->n_bytes_committed += __atomic_load_n(&(source->n_bytes_committed), __ATOMIC_RELAXED);
+    stat->n_bytes_resident += __atomic_load_n(&(source->n_bytes_resident), __ATOMIC_RELAXED);
+    stat->n_bytes_reclaimed += __atomic_load_n(&(source->n_bytes_reclaimed), __ATOMIC_RELAXED);
+    stat->n_reclaims += __atomic_load_n(&(source->n_reclaims), __ATOMIC_RELAXED);
+}
+
+struct p7r_stack_zone_stat p7r_stack_allocator_class_stat(struct p7r_stack_allocator *allocator, uint32_t size_class, uint32_t zone) {
+    struct p7r_stack_zone_stat stat;
+    memset(&stat, 0, sizeof(struct p7r_stack_zone_stat));
+    (size_class < allocator->n_size_classes) && (p7r_stack_zone_stat_add(&stat, &(allocator->size_classes[size_class]), zone), 0);
+    return stat;
+}
+
+// summed over all size classes
+struct p7r_stack_zone_stat p7r_stack_allocator_stat(struct p7r_stack_allocator *allocator, uint32_t zone) {
+    struct p7r_stack_zone_stat stat;
+    memset(&stat, 0, sizeof(struct p7r_stack_zone_stat));
+    for (uint32_t index = 0; index < allocator->n_size_classes; index++)
+        p7r_stack_zone_stat_add(&stat, &(allocator->size_classes[index]), zone);
+    return stat;
+}
+
+static
+uint64_t p7r_stack_provider_trim(struct p7r_stack_page_provider *provider) {
+    uint64_t n_bytes = provider->n_dirty * p7r_stack_bytes_user(provider);
+    while (provider->n_dirty)
+        p7r_stack_page_reclaim(provider);
+    return n_bytes;
+}
+
+uint64_t p7r_stack_allocator_trim(struct p7r_stack_allocator *allocator) {
+    uint64_t n_bytes = 0;
+    for (uint32_t index = 0; index < allocator->n_size_classes; index++) {
+        struct p7r_stack_size_class *size_class = &(allocator->size_classes[index]);
+        n_bytes += p7r_stack_provider_trim(&(size_class->long_term)) + p7r_stack_provider_trim(&(size_class->short_term));
+        list_ctl_t *slave_iterator;
+        list_foreach(slave_iterator, &(size_class->slaves.slaves))
+            n_bytes += p7r_stack_provider_trim(container_of(slave_iterator, struct p7r_stack_page_provider, linkable));
+    }
+    return n_bytes;
+}
+
+uint32_t p7r_stack_allocator_n_slaves(struct p7r_stack_allocator *allocator) {
+    uint32_t n_slaves = 0;
+    for (uint32_t index = 0; index < allocator->n_size_classes; index++)
+        n_slaves += allocator->size_classes[index].slaves.n_slaves;
+    return n_slaves;
+}
+
+struct p7r_stack_allocator *p7r_stack_allocator_init(struct p7r_stack_allocator *allocator, struct p7r_stack_allocator_config config) {
+    allocator->properties = p7r_stack_allocator_config_adjust(&config);
+    allocator->n_size_classes = 0;
+
+    struct p7r_stack_size_class_config size_class = {
+        .n_pages_stack_total = allocator->properties.n_pages_stack_total,
+        .n_pages_long_term = allocator->properties.n_pages_long_term,
+        .n_pages_short_term = allocator->properties.n_pages_short_term,
+        .n_pages_slave = allocator->properties.n_pages_slave
+    };
+    for (uint32_t index = 0; index <= allocator->properties.n_extra_size_classes; index++) {
+        (index) && (size_class = allocator->properties.size_classes[index - 1], 0);
+        if (p7r_stack_size_class_init(&(allocator->size_classes[index]), index, size_class, allocator) == NULL) {
+            p7r_stack_allocator_ruin(allocator);
+            return NULL;
+        }
+        allocator->n_size_classes++;
+    }
+
+    return allocator;
+}
+
+void p7r_stack_allocator_ruin(struct p7r_stack_allocator *allocator) {
+    for (uint32_t index = 0; index < allocator->n_size_classes; index++)
+        p7r_stack_size_class_ruin(&(allocator->size_classes[index]));
+}
+
+struct p7r_stack_metamark *p7r_stack_allocate(int type, struct p7r_stack_allocator *allocator, uint32_t size_class_index) {
     struct p7r_stack_metamark *result;
+    struct p7r_stack_size_class *size_class = p7r_stack_size_class_of(allocator, size_class_index);
 
     switch (type) {
         case P7R_STACK_SOURCE_DEFAULT:
-            result = p7r_stack_page_allocate_long_term(allocator);
+            result = p7r_stack_page_allocate_long_term(size_class);
             break;
         case P7R_STACK_SOURCE_SHORT_TERM:
-            result = p7r_stack_page_allocate_short_term(allocator);
+            result = p7r_stack_page_allocate_short_term(size_class);
             break;
         default:
             result = NULL;
@@ -4,6 +4,7 @@
 #include    "./p7r_stdc_common.h"
 #include    "./p7r_linux_common.h"
 #include    "./p7r_scraft_common.h"
+#include    "./p7r_numa.h"
 
 #define     P7R_STACK_ALLOCATOR_MASTER      0
 #define     P7R_STACK_ALLOCATOR_SLAVE       1
@@ -11,14 +12,63 @@
 #define     P7R_STACK_SOURCE_DEFAULT        0
 #define     P7R_STACK_SOURCE_SHORT_TERM     1
 
+#define     P7R_STACK_ZONE_LONG_TERM        0
+#define     P7R_STACK_ZONE_SHORT_TERM       1
+#define     P7R_STACK_ZONE_SLAVES           2
+#define     P7R_N_STACK_ZONES               3
+
+// how freed stacks give their pages back
+#define     P7R_STACK_RECLAIM_DONTNEED      0
+#define     P7R_STACK_RECLAIM_FREE          1       // lazier, RSS only drops under memory pressure
+
+#define     P7R_STACK_RECLAIM_DEFAULT_WATERMARK     64
+#define     P7R_STACK_RECLAIM_NEVER                 UINT32_MAX
+
+#define     P7R_STACK_CANARY                UINT64_C(0xca9a3ca9a3ca9a3c)
+
+// class 0 is the stack size of the config itself, the extra ones follow
+#define     P7R_STACK_MAX_SIZE_CLASSES      4
+#define     P7R_STACK_CLASS_DEFAULT         0
+#define     P7R_STACK_CLASS_AUTO            UINT32_MAX      // whatever the stack hint of the entrance suggests
+
 #include    "./p7r_stack_metamark.h"
 
 
+struct p7r_stack_size_class_config {
+    uint32_t n_pages_stack_total;
+    // 0 for as many stacks as the zone of the default class holds
+    uint32_t n_pages_long_term, n_pages_short_term;
+    uint32_t n_pages_slave;
+};
+
 struct p7r_stack_allocator_config {
     uint32_t n_pages_long_term, n_pages_short_term;
     uint32_t n_pages_slave;
     uint32_t n_pages_stack_total, n_pages_stack_user;
     uint32_t n_bytes_page;
+    // freed stacks a zone keeps resident for reuse before it madvises the coldest away, 0 for the default
+    uint32_t reclaim_watermark;
+    uint32_t reclaim_advice;
+    // paint stacks with P7R_STACK_CANARY so that their high-water mark can be measured - costs a full touch of
+    // every fresh stack, for profiling only
+    int high_water_profile;
+    // stack sizes besides the one above, class i + 1 being size_classes[i]
+    uint32_t n_extra_size_classes;
+    struct p7r_stack_size_class_config size_classes[P7R_STACK_MAX_SIZE_CLASSES - 1];
+    // preferred node + 1 of every zone, P7R_NUMA_ANYWHERE for none - p7r_init fills it in per carrier
+    uint32_t numa_node;
+};
+
+/*
+ * Byte counters of one zone, stacks only - the metadata page of each stack stays resident for good.
+ * Resident is an upper bound: a stack counts in full from its first use until it gets reclaimed.
+ */
+struct p7r_stack_zone_stat {
+    uint64_t n_bytes_reserved;          // address space mapped
+    uint64_t n_bytes_committed;         // stacks handed out right now
+    uint64_t n_bytes_resident;          // committed, plus freed stacks not reclaimed yet
+    uint64_t n_bytes_reclaimed;
+    uint64_t n_reclaims;
 };
 
 struct p7r_stack_page_provider {
@@ -27,32 +77,63 @@ struct p7r_stack_page_provider {
     size_t total_size;
     char *zone;
     struct p7r_stack_allocator *parent;
-    list_ctl_t linkable, pages;
+    struct p7r_stack_size_class *size_class;
+    list_ctl_t linkable;
+    list_ctl_t pages, clean_pages;      // freed stacks still dirty, most recent first - and those never used or reclaimed
+    uint32_t n_dirty;
+    struct p7r_stack_zone_stat *stat;   // slaves share the one of their slaver
+    struct p7r_stack_zone_stat own_stat;
 };
 
 struct p7r_stack_page_slaver {
     uint32_t n_slaves;
     list_ctl_t slaves;
+    struct p7r_stack_zone_stat stat;
 };
 
-struct p7r_stack_allocator {
-    struct p7r_stack_allocator_config properties;
+// Zones of one stack size - every class maps its own, so stacks of a zone stay interchangeable.
+struct p7r_stack_size_class {
+    uint32_t index;
+    uint32_t n_pages_stack_total, n_pages_stack_user;
+    uint32_t n_pages_long_term, n_pages_short_term, n_pages_slave;
     struct p7r_stack_page_provider long_term, short_term;
     struct p7r_stack_page_slaver slaves;
 };
 
+struct p7r_stack_allocator {
+    struct p7r_stack_allocator_config properties;
+    uint32_t n_size_classes;
+    struct p7r_stack_size_class size_classes[P7R_STACK_MAX_SIZE_CLASSES];
+};
+
 struct p7r_stack_allocator *p7r_stack_allocator_init(struct p7r_stack_allocator *allocator, struct p7r_stack_allocator_config config);
 void p7r_stack_allocator_ruin(struct p7r_stack_allocator *allocator);
 
-struct p7r_stack_metamark *p7r_stack_allocate(int type, struct p7r_stack_allocator *allocator);
+struct p7r_stack_metamark *p7r_stack_allocate(int type, struct p7r_stack_allocator *allocator, uint32_t size_class);
 void p7r_stack_free(struct p7r_stack_metamark *mark);
 
-struct p7r_stack_metamark *p7r_stack_page_allocate_fallback(struct p7r_stack_allocator *allocator);
+// unknown classes fall back to the default one
+struct p7r_stack_size_class *p7r_stack_size_class_of(struct p7r_stack_allocator *allocator, uint32_t size_class);
+// smallest class with at least n_bytes of user stack, the biggest one when none is
+uint32_t p7r_stack_size_class_fit(struct p7r_stack_allocator *allocator, uint64_t n_bytes);
+
+struct p7r_stack_metamark *p7r_stack_page_allocate_fallback(struct p7r_stack_size_class *size_class);
 struct p7r_stack_metamark *p7r_stack_page_allocate(struct p7r_stack_page_provider *provider);
 void p7r_stack_page_free(struct p7r_stack_metamark *mark);
 
 double p7r_stack_allocator_usage(struct p7r_stack_allocator *allocator);
 
+#define     p7r_stack_bytes_of(mark_)       \
+    ((uint64_t) (mark_)->n_bytes_page * (mark_)->provider->size_class->n_pages_stack_user)
+
+void p7r_stack_paint(char *from, char *to);
+char *p7r_stack_deepest(struct p7r_stack_metamark *mark);
+struct p7r_stack_zone_stat p7r_stack_allocator_stat(struct p7r_stack_allocator *allocator, uint32_t zone);
+struct p7r_stack_zone_stat p7r_stack_allocator_class_stat(struct p7r_stack_allocator *allocator, uint32_t size_class, uint32_t zone);
+uint32_t p7r_stack_allocator_n_slaves(struct p7r_stack_allocator *allocator);
+// reclaims every freed stack at once, whatever the watermark - returns the bytes given back
+uint64_t p7r_stack_allocator_trim(struct p7r_stack_allocator *allocator);
+
 
 
 #endif      // P7R_STACK_ALLOCATOR_
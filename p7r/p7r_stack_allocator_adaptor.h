@@ -11,18 +11,16 @@
 
 #include    "./p7r_stack_allocator.h"
 #include    "./p7r_stack_hint.h"
+#include    "./p7r_stack_hint_dictionary.h"
 
 #define     stack_metamark_create       p7r_stack_allocate_hintless
+#define     stack_metamark_create_hinted    p7r_stack_allocate_with_hint
 #define     stack_metamark_destroy      p7r_stack_free
 
 #define     stack_allocator_init        p7r_stack_allocator_init
 #define     stack_allocator_ruin        p7r_stack_allocator_ruin
 
-#define     stack_size_of(metamark_)    \
-    ({ \
-        __auto_type metamark__ = (metamark_); \
-        metamark__->n_bytes_page * (metamark__->provider->parent->properties.n_pages_stack_user); \
-    })
+#define     stack_size_of               p7r_stack_bytes_of
 #define     stack_base_of(metamark_)    ((metamark_)->raw_content_addr)
 #define     stack_meta_of(metamark_)    ((metamark_)->user_metadata)
 
@@ -10,7 +10,9 @@ void config_as_base_of(struct p7r_stack_hint *hint, const struct p7r_stack_hint_
 
 static inline
 void init_policy(struct p7r_stack_hint *hint) {
-    hint->policy = P7R_STACK_POLICY_DEFAULT;
+    (hint->policy = P7R_STACK_POLICY_DEFAULT), (hint->size_class = P7R_STACK_CLASS_DEFAULT);
+    memset(&(hint->depth_stat), 0, sizeof(struct p7r_hint_depth_stat));
+    hint->next_registered = NULL;
 }
 
 struct p7r_stack_hint *p7r_stack_hint_init_by_name(struct p7r_stack_hint *hint, const char *name, const struct p7r_stack_hint_config *config) {
@@ -56,42 +58,80 @@ void p7r_stack_hint_delete(struct p7r_stack_hint *hint) {
     scraft_deallocate(allocator, hint);
 }
 
-struct p7r_stack_metamark *p7r_stack_allocate_with_hint(struct p7r_stack_allocator *allocator, struct p7r_stack_hint *hint) {
+void p7r_stack_hint_record_lifetime(struct p7r_stack_hint *hint, double lifetime_us) {
+    struct p7r_hint_execution_time_stat *stat = &(hint->execution_time_stat);
+    (stat->measure_recent < P7R_STACK_HINT_WARMUP) && (stat->measure_recent++);
+    stat->recent = lifetime_us;
+    stat->average += (lifetime_us - stat->average) / stat->measure_recent;
+}
+
+uint32_t p7r_stack_depth_bucket(uint64_t depth) {
+    if (depth < 1024)
+        return 0;
+    uint32_t bucket = 64 - __builtin_clzll(depth) - 10;
+    return (bucket < P7R_STACK_DEPTH_N_BUCKETS) ? bucket : (P7R_STACK_DEPTH_N_BUCKETS - 1);
+}
+
+void p7r_stack_hint_record_depth(struct p7r_stack_hint *hint, uint64_t depth) {
+    struct p7r_hint_depth_stat *stat = &(hint->depth_stat);
+    uint32_t bucket = p7r_stack_depth_bucket(depth);
+    __atomic_store_n(&(stat->histogram[bucket]), stat->histogram[bucket] + 1, __ATOMIC_RELAXED);
+    (depth > stat->max) && (__atomic_store_n(&(stat->max), depth, __ATOMIC_RELAXED), 0);
+    __atomic_store_n(&(stat->n_samples), stat->n_samples + 1, __ATOMIC_RELAXED);
+}
+
+uint8_t p7r_stack_hint_adapt(struct p7r_stack_hint *hint, double eden_below_us, double prudent_above_us) {
+    if (hint->execution_time_stat.measure_recent < P7R_STACK_HINT_WARMUP)
+        return hint->policy;
+    if (hint->execution_time_stat.average < eden_below_us)
+        hint->policy = P7R_STACK_POLICY_EDEN;
+    else if (hint->execution_time_stat.average > prudent_above_us)
+        hint->policy = P7R_STACK_POLICY_PRUDENT;
+    return hint->policy;
+}
+
+uint32_t p7r_stack_hint_fit(struct p7r_stack_hint *hint, struct p7r_stack_allocator *allocator) {
+    if (hint->depth_stat.n_samples < P7R_STACK_HINT_WARMUP)
+        return hint->size_class;
+    return hint->size_class = p7r_stack_size_class_fit(allocator, hint->depth_stat.max * P7R_STACK_HINT_DEPTH_HEADROOM);
+}
+
+struct p7r_stack_metamark *p7r_stack_allocate_with_hint(struct p7r_stack_allocator *allocator, uint32_t size_class_index, struct p7r_stack_hint *hint) {
     struct p7r_stack_metamark *stack_mark = NULL;
-    uint32_t failure = 0;
-    (hint->failure_stat.measure_total < hint->failure_stat.measure_limit) && (hint->failure_stat.measure_total++);
-    // TODO optimization - long zone would be used up soon, check this fact as early as possible
-    switch(hint->policy) {
-        case P7R_STACK_POLICY_PRUDENT:
-            stack_mark = p7r_stack_page_allocate(&(allocator->long_term));
-            if (stack_mark)
-                return stack_mark;
-            failure++;
-        case P7R_STACK_POLICY_EDEN:
-            stack_mark = p7r_stack_page_allocate(&(allocator->short_term));
-            if (stack_mark)
-                return stack_mark;
-            failure++;
-        default:
-            stack_mark = p7r_stack_page_allocate_fallback(allocator);
-    }
-    hint->failure_stat.measure_failed += (failure > 0);
-    return stack_mark;
+    struct p7r_stack_page_provider *preferred, *spill;
+    struct p7r_stack_size_class *size_class = 
+        p7r_stack_size_class_of(allocator, (size_class_index == P7R_STACK_CLASS_AUTO) ? hint->size_class : size_class_index);
+    // halve the window instead of saturating it, the ratio keeps following what happens now
+    if (hint->failure_stat.measure_total >= hint->failure_stat.measure_limit)
+        (hint->failure_stat.measure_total >>= 1), (hint->failure_stat.measure_failed >>= 1);
+    hint->failure_stat.measure_total++;
+    // either master zone before a slave gets mapped
+    if (hint->policy == P7R_STACK_POLICY_EDEN)
+        (preferred = &(size_class->short_term)), (spill = &(size_class->long_term));
+    else
+        (preferred = &(size_class->long_term)), (spill = &(size_class->short_term));
+    if ((stack_mark = p7r_stack_page_allocate(preferred)) != NULL)
+        return stack_mark;
+    hint->failure_stat.measure_failed++;
+    if ((stack_mark = p7r_stack_page_allocate(spill)) != NULL)
+        return stack_mark;
+    return p7r_stack_page_allocate_fallback(size_class);
 }
 
-struct p7r_stack_metamark *p7r_stack_allocate_hintless(struct p7r_stack_allocator *allocator, uint8_t policy) {
+struct p7r_stack_metamark *p7r_stack_allocate_hintless(struct p7r_stack_allocator *allocator, uint32_t size_class_index, uint8_t policy) {
     struct p7r_stack_metamark *stack_mark = NULL;
+    struct p7r_stack_size_class *size_class = p7r_stack_size_class_of(allocator, size_class_index);
     switch(policy) {
         case P7R_STACK_POLICY_PRUDENT:
-            stack_mark = p7r_stack_page_allocate(&(allocator->long_term));
+            stack_mark = p7r_stack_page_allocate(&(size_class->long_term));
             if (stack_mark)
                 return stack_mark;
         case P7R_STACK_POLICY_EDEN:
-            stack_mark = p7r_stack_page_allocate(&(allocator->short_term));
+            stack_mark = p7r_stack_page_allocate(&(size_class->short_term));
             if (stack_mark)
                 return stack_mark;
         default:
-            stack_mark = p7r_stack_page_allocate_fallback(allocator);
+            stack_mark = p7r_stack_page_allocate_fallback(size_class);
     }
     return stack_mark;
 }
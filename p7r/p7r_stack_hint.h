@@ -6,15 +6,26 @@
 #include    "./p7r_scraft_common.h"
 #include    "./p7r_stack_allocator.h"
 
+// lifetimes in us
 struct p7r_hint_execution_time_stat {
     double average, recent;
-    uint32_t measure_recent;
+    uint32_t measure_recent;        // samples in average, saturates at P7R_STACK_HINT_WARMUP
 };
 
+// allocations which missed the zone of the policy, over a window of measure_limit allocations
 struct p7r_hint_failure_stat {
     uint32_t measure_limit, measure_total, measure_failed;
 };
 
+// Stack high-water marks in bytes, bucket 0 below 1 KiB, bucket i below 2^(i + 10) bytes, the last one open.
+// Written by the owning carrier only, safe to read from anywhere.
+#define     P7R_STACK_DEPTH_N_BUCKETS       16
+
+struct p7r_hint_depth_stat {
+    uint64_t n_samples, max;
+    uint64_t histogram[P7R_STACK_DEPTH_N_BUCKETS];
+};
+
 struct p7r_stack_hint_config {
     struct p7r_hint_execution_time_stat execution_time_stat;
     struct p7r_hint_failure_stat failure_stat;
@@ -27,20 +38,42 @@ struct p7r_stack_hint {
     } key;
     struct p7r_hint_execution_time_stat execution_time_stat;
     struct p7r_hint_failure_stat failure_stat;
+    struct p7r_hint_depth_stat depth_stat;
     uint8_t policy;
+    uint32_t size_class;
     struct scraft_hashkey hashable;
+    struct p7r_stack_hint *next_registered;
 };
 
 #define     P7R_STACK_POLICY_DEFAULT        P7R_STACK_SOURCE_DEFAULT
 #define     P7R_STACK_POLICY_EDEN           P7R_STACK_SOURCE_SHORT_TERM
 #define     P7R_STACK_POLICY_PRUDENT        P7R_STACK_SOURCE_DEFAULT
 
+// plain mean over the first samples, exponential with this weight afterwards
+#define     P7R_STACK_HINT_WARMUP                   16
+#define     P7R_STACK_HINT_FAILURE_WINDOW           64
+
+#define     P7R_STACK_HINT_DEFAULT_CAPACITY         256
+#define     P7R_STACK_HINT_DEFAULT_EDEN_BELOW_US    1000
+#define     P7R_STACK_HINT_DEFAULT_PRUDENT_ABOVE_US 100000
+// a class gets picked for this many times the deepest stack seen so far
+#define     P7R_STACK_HINT_DEPTH_HEADROOM           4
+
 struct p7r_stack_hint *p7r_stack_hint_init_by_name(struct p7r_stack_hint *hint, const char *name, const struct p7r_stack_hint_config *config);
 struct p7r_stack_hint *p7r_stack_hint_init_by_entrance(struct p7r_stack_hint *hint, void (*entrance)(void *), const struct p7r_stack_hint_config *config);
 struct p7r_stack_hint *p7r_stack_hint_new_from_name(const char *name, struct p7r_stack_hint_config config);
 struct p7r_stack_hint *p7r_stack_hint_new_from_entrance(void (*entrance)(void *), struct p7r_stack_hint_config config);
+void p7r_stack_hint_delete(struct p7r_stack_hint *hint);
+
+void p7r_stack_hint_record_lifetime(struct p7r_stack_hint *hint, double lifetime_us);
+void p7r_stack_hint_record_depth(struct p7r_stack_hint *hint, uint64_t depth);
+uint32_t p7r_stack_depth_bucket(uint64_t depth);
+// Once warmed up, moves short-lived entrances to EDEN and long-lived ones to PRUDENT; in between nothing changes.
+uint8_t p7r_stack_hint_adapt(struct p7r_stack_hint *hint, double eden_below_us, double prudent_above_us);
+// Once warmed up, moves the entrance to the smallest size class its deepest stack fits into with headroom.
+uint32_t p7r_stack_hint_fit(struct p7r_stack_hint *hint, struct p7r_stack_allocator *allocator);
 
-struct p7r_stack_metamark *p7r_stack_allocate_hintless(struct p7r_stack_allocator *allocator, uint8_t policy);
+struct p7r_stack_metamark *p7r_stack_allocate_hintless(struct p7r_stack_allocator *allocator, uint32_t size_class, uint8_t policy);
 
 #define p7r_stack_hint_init(hint_, arg_, config_) \
     _Generic((arg_), char *: p7r_stack_hint_init_by_name, void (*)(void *): p7r_stack_hint_init_by_entrance)((hint_), (arg_), (config_))
@@ -48,7 +81,8 @@ struct p7r_stack_metamark *p7r_stack_allocate_hintless(struct p7r_stack_allocato
 #define p7r_stack_hint_new(arg_, config_) \
     _Generic((arg_), char *: p7r_stack_hint_new_from_name, void (*)(void *): p7r_stack_hint_new_from_entrance)((hint_), (arg_), (config_))
 
-struct p7r_stack_metamark *p7r_stack_allocate_with_hint(struct p7r_stack_allocator *allocator, struct p7r_stack_hint *hint);
+// size class P7R_STACK_CLASS_AUTO takes the one of the hint
+struct p7r_stack_metamark *p7r_stack_allocate_with_hint(struct p7r_stack_allocator *allocator, uint32_t size_class, struct p7r_stack_hint *hint);
 
 uint64_t p7r_stack_hint_entry_hash(struct scraft_hashkey *key);
 int p7r_stack_hint_entry_destroy(struct scraft_hashkey *key);
@@ -10,7 +10,8 @@ struct p7r_stack_hint_dictionary *p7r_stack_hint_dictionary_init(
     __auto_type allocator = p7r_root_alloc_get_proxy();
     if ((dictionary->hashtable = scraft_hashtable_new(allocator, capacity, p7r_stack_hint_entry_compare, p7r_stack_hint_entry_destroy, p7r_stack_hint_entry_hash)) == NULL)
         return NULL;
-    dictionary->allocator = stack_allocator;
+    (dictionary->allocator = stack_allocator), (dictionary->n_hints = 0), (dictionary->capacity = capacity);
+    __atomic_store_n(&(dictionary->registered), NULL, __ATOMIC_RELEASE);
     return dictionary;
 }
 
@@ -19,7 +20,13 @@ void p7r_stack_hint_dictionary_ruin(struct p7r_stack_hint_dictionary *dictionary
 }
 
 int p7r_stack_hint_dictionary_put(struct p7r_stack_hint_dictionary *dictionary, struct p7r_stack_hint *hint) {
-    return scraft_hashtable_insert(dictionary->hashtable, &(hint->hashable)) != NULL;
+    int inserted = scraft_hashtable_insert(dictionary->hashtable, &(hint->hashable)) != NULL;
+    dictionary->n_hints += inserted;
+    if (inserted) {
+        hint->next_registered = dictionary->registered;
+        __atomic_store_n(&(dictionary->registered), hint, __ATOMIC_RELEASE);
+    }
+    return inserted;
 }
 
 static inline
@@ -42,7 +49,15 @@ struct p7r_stack_hint *p7r_stack_hint_dictionary_get_by_entrance(struct p7r_stac
 
 static inline
 void do_delete_hint(struct p7r_stack_hint_dictionary *dictionary, struct p7r_stack_hint *hint_dummy) {
-    scraft_hashtable_delete(dictionary->hashtable, &(hint_dummy->hashable));
+    struct scraft_hashkey *target_key = scraft_hashtable_remove(dictionary->hashtable, &(hint_dummy->hashable));
+    if (unlikely(target_key == NULL))
+        return;
+    dictionary->n_hints--;
+    struct p7r_stack_hint *target = container_of(target_key, struct p7r_stack_hint, hashable), **link = &(dictionary->registered);
+    while (*link && (*link != target))
+        link = &((*link)->next_registered);
+    (*link) && (__atomic_store_n(link, target->next_registered, __ATOMIC_RELEASE), 0);
+    p7r_stack_hint_entry_destroy(target_key);
 }
 
 void p7r_stack_hint_dictionary_delete_by_name(struct p7r_stack_hint_dictionary *dictionary, const char *name) {
@@ -10,6 +10,9 @@
 struct p7r_stack_hint_dictionary {
     struct scraft_hashtable *hashtable;
     struct p7r_stack_allocator *allocator;
+    uint64_t n_hints, capacity;
+    // every hint ever put, newest first - for readers on other threads, the hashtable is owner-only
+    struct p7r_stack_hint *registered;
 };
 
 struct p7r_stack_hint_dictionary *p7r_stack_hint_dictionary_init(
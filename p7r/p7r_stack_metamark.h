@@ -15,5 +15,7 @@ struct p7r_stack_metamark {
     char user_metadata[];
 } __attribute__((packed));
 
+// linkable through its offset - &(mark->linkable) of a packed struct warns
+#define     P7R_STACK_METAMARK_LINK_OF(mark_)   ((list_ctl_t *) ((char *) (mark_) + offset_of(struct p7r_stack_metamark, linkable)))
 
 #endif      // P7R_STACK_METAMARK_H_
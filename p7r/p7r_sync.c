@@ -0,0 +1,424 @@
+#include    "./p7r_sync.h"
+#include    "./p7r_uthread.h"
+#include    "./p7r_timing.h"
+
+#include    <sys/syscall.h>
+#include    <linux/futex.h>
+
+
+// Lives on the waiter's stack - it must not leave before a releaser which claimed it has granted it.
+struct p7r_sync_waiter {
+    list_ctl_t linkable;
+    struct p7r_delegation *delegation;      // NULL for an OS thread
+    struct p7r_mutex *mutex;                // condvar waiters - what they get handed once signalled
+    uint32_t granted;                       // futex word of an OS thread
+    int claimed;                            // taken off the wait list, under the lock of that list
+    int exclusive;                          // rwlock writers
+};
+
+static inline
+int p7r_sync_futex(uint32_t *word, int operation, uint32_t value, const struct timespec *timeout) {
+    return (int) syscall(SYS_futex, word, operation, value, timeout, NULL, 0);
+}
+
+static inline
+struct p7r_sync_waiter *p7r_sync_waiter_prepare(struct p7r_sync_waiter *waiter, struct p7r_delegation *delegation, int exclusive) {
+    waiter->delegation = p7r_in_uthread() ? p7r_waiter_prepare(delegation) : NULL;
+    (waiter->mutex = NULL), (waiter->granted = 0), (waiter->claimed = 0), (waiter->exclusive = exclusive);
+    return waiter;
+}
+
+static inline
+struct p7r_sync_waiter *p7r_sync_waiter_claim(list_ctl_t *waiters) {
+    if (list_is_empty(waiters))
+        return NULL;
+    struct p7r_sync_waiter *waiter = container_of(waiters->next, struct p7r_sync_waiter, linkable);
+    list_del(&(waiter->linkable));
+    waiter->claimed = 1;
+    return waiter;
+}
+
+// Outside of any lock. The waiter may be gone the moment it is granted.
+static
+void p7r_sync_waiter_grant(struct p7r_sync_waiter *waiter) {
+    struct p7r_delegation *delegation = waiter->delegation;
+    if (delegation) {
+        p7r_waiter_wake(delegation);
+        return;
+    }
+    __atomic_store_n(&(waiter->granted), 1, __ATOMIC_RELEASE);
+    p7r_sync_futex(&(waiter->granted), FUTEX_WAKE_PRIVATE, 1, NULL);
+}
+
+static
+int p7r_sync_os_wait(uint32_t *granted, uint64_t timeout_ms) {
+    uint64_t deadline = timeout_ms ? get_timestamp_ns_monotonic() + timeout_ms * 1000000 : 0;
+    while (!__atomic_load_n(granted, __ATOMIC_ACQUIRE)) {
+        struct timespec remaining, *timeout = NULL;
+        if (deadline) {
+            uint64_t current = get_timestamp_ns_monotonic();
+            if (current >= deadline)
+                return 0;
+            (remaining.tv_sec = (deadline - current) / 1000000000), (remaining.tv_nsec = (deadline - current) % 1000000000);
+            timeout = &remaining;
+        }
+        p7r_sync_futex(granted, FUTEX_WAIT_PRIVATE, 0, timeout);
+    }
+    return 1;
+}
+
+// Returns 1 once granted, 0 if timed out and taken off the wait list guarded by lock.
+static
+int p7r_sync_waiter_park(struct p7r_sync_waiter *waiter, pthread_spinlock_t *lock, uint64_t timeout_ms) {
+    if (waiter->delegation ? p7r_waiter_park(waiter->delegation, timeout_ms) : p7r_sync_os_wait(&(waiter->granted), timeout_ms))
+        return 1;
+    pthread_spin_lock(lock);
+    int claimed = waiter->claimed;
+    claimed || (list_del(&(waiter->linkable)), 0);
+    pthread_spin_unlock(lock);
+    if (!claimed)
+        return 0;
+    // claimed just as we gave up - the grant is on its way
+    waiter->delegation ? p7r_waiter_park(waiter->delegation, 0) : p7r_sync_os_wait(&(waiter->granted), 0);
+    return 1;
+}
+
+
+// instrumentation
+
+static inline
+void p7r_sync_stat_max(uint64_t *max, uint64_t value) {
+    uint64_t current = __atomic_load_n(max, __ATOMIC_RELAXED);
+    while ((value > current) && !__atomic_compare_exchange_n(max, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+// wait_begin is 0 for an uncontended acquisition
+static
+uint64_t p7r_sync_stat_acquired(struct p7r_sync_stat *stat, uint64_t wait_begin) {
+    uint64_t current = get_timestamp_ns_monotonic();
+    __atomic_add_fetch(&(stat->n_acquired), 1, __ATOMIC_RELAXED);
+    if (wait_begin) {
+        __atomic_add_fetch(&(stat->n_contended), 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&(stat->wait_ns), current - wait_begin, __ATOMIC_RELAXED);
+        p7r_sync_stat_max(&(stat->max_wait_ns), current - wait_begin);
+    }
+    return current;
+}
+
+static
+void p7r_sync_stat_released(struct p7r_sync_stat *stat, uint64_t acquired_at) {
+    uint64_t hold = get_timestamp_ns_monotonic() - acquired_at;
+    __atomic_add_fetch(&(stat->hold_ns), hold, __ATOMIC_RELAXED);
+    p7r_sync_stat_max(&(stat->max_hold_ns), hold);
+}
+
+#define     p7r_sync_wait_begin(stat_)      (unlikely((stat_) != NULL) ? get_timestamp_ns_monotonic() : 0)
+
+
+// mutex
+
+static inline
+void p7r_mutex_acquired(struct p7r_mutex *mutex, uint64_t wait_begin) {
+    if (unlikely(mutex->stat != NULL))
+        mutex->acquired_at = p7r_sync_stat_acquired(mutex->stat, wait_begin);
+}
+
+// Under the waiters lock: takes the mutex if it is free, queues the waiter for a handoff otherwise.
+static
+int p7r_mutex_take_or_queue(struct p7r_mutex *mutex, struct p7r_sync_waiter *waiter) {
+    uint32_t state = __atomic_load_n(&(mutex->state), __ATOMIC_RELAXED);
+    for (;;) {
+        if (state == P7R_MUTEX_UNLOCKED) {
+            if (__atomic_compare_exchange_n(&(mutex->state), &state, P7R_MUTEX_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+                return 1;
+        } else if ((state == P7R_MUTEX_CONTENDED) ||
+                __atomic_compare_exchange_n(&(mutex->state), &state, P7R_MUTEX_CONTENDED, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            // an unlock racing with us now has to come through the lock we hold
+            list_add_tail(&(waiter->linkable), &(mutex->waiters));
+            return 0;
+        }
+    }
+}
+
+int p7r_mutex_init(struct p7r_mutex *mutex) {
+    (mutex->state = P7R_MUTEX_UNLOCKED), (mutex->stat = NULL), (mutex->acquired_at = 0);
+    init_list_head(&(mutex->waiters));
+    return pthread_spin_init(&(mutex->lock), PTHREAD_PROCESS_PRIVATE);
+}
+
+void p7r_mutex_ruin(struct p7r_mutex *mutex) {
+    pthread_spin_destroy(&(mutex->lock));
+}
+
+int p7r_mutex_trylock(struct p7r_mutex *mutex) {
+    uint32_t expected = P7R_MUTEX_UNLOCKED;
+    if (!__atomic_compare_exchange_n(&(mutex->state), &expected, P7R_MUTEX_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+        return (errno = EBUSY), -1;
+    p7r_mutex_acquired(mutex, 0);
+    return 0;
+}
+
+void p7r_mutex_lock(struct p7r_mutex *mutex) {
+    uint32_t expected = P7R_MUTEX_UNLOCKED;
+    if (likely(__atomic_compare_exchange_n(&(mutex->state), &expected, P7R_MUTEX_LOCKED, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))) {
+        p7r_mutex_acquired(mutex, 0);
+        return;
+    }
+    uint64_t wait_begin = p7r_sync_wait_begin(mutex->stat);
+    struct p7r_delegation delegation;
+    struct p7r_sync_waiter waiter;
+    p7r_sync_waiter_prepare(&waiter, &delegation, 1);
+    pthread_spin_lock(&(mutex->lock));
+    int taken = p7r_mutex_take_or_queue(mutex, &waiter);
+    pthread_spin_unlock(&(mutex->lock));
+    taken || p7r_sync_waiter_park(&waiter, &(mutex->lock), 0);
+    p7r_mutex_acquired(mutex, taken ? 0 : wait_begin);
+}
+
+void p7r_mutex_unlock(struct p7r_mutex *mutex) {
+    unlikely(mutex->stat != NULL) && (p7r_sync_stat_released(mutex->stat, mutex->acquired_at), 0);
+    uint32_t expected = P7R_MUTEX_LOCKED;
+    if (likely(__atomic_compare_exchange_n(&(mutex->state), &expected, P7R_MUTEX_UNLOCKED, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)))
+        return;
+    struct p7r_sync_waiter *next;
+    pthread_spin_lock(&(mutex->lock));
+    if ((next = p7r_sync_waiter_claim(&(mutex->waiters))) != NULL)
+        // handed over - it never gets unlocked in between
+        __atomic_store_n(&(mutex->state), list_is_empty(&(mutex->waiters)) ? P7R_MUTEX_LOCKED : P7R_MUTEX_CONTENDED, __ATOMIC_RELAXED);
+    else
+        __atomic_store_n(&(mutex->state), P7R_MUTEX_UNLOCKED, __ATOMIC_RELEASE);
+    pthread_spin_unlock(&(mutex->lock));
+    next && (p7r_sync_waiter_grant(next), 0);
+}
+
+void p7r_mutex_instrument(struct p7r_mutex *mutex, struct p7r_sync_stat *stat) {
+    stat && memset(stat, 0, sizeof(struct p7r_sync_stat));
+    mutex->stat = stat;
+}
+
+
+// condition variable
+
+// A signalled waiter goes on to the mutex wait list instead of waking up just to contend for it.
+static
+void p7r_condvar_requeue(struct p7r_sync_waiter *waiter) {
+    struct p7r_mutex *mutex = waiter->mutex;
+    pthread_spin_lock(&(mutex->lock));
+    int taken = p7r_mutex_take_or_queue(mutex, waiter);
+    pthread_spin_unlock(&(mutex->lock));
+    taken && (p7r_sync_waiter_grant(waiter), 0);
+}
+
+int p7r_condvar_init(struct p7r_condvar *condvar) {
+    init_list_head(&(condvar->waiters));
+    return pthread_spin_init(&(condvar->lock), PTHREAD_PROCESS_PRIVATE);
+}
+
+void p7r_condvar_ruin(struct p7r_condvar *condvar) {
+    pthread_spin_destroy(&(condvar->lock));
+}
+
+int p7r_condvar_wait(struct p7r_condvar *condvar, struct p7r_mutex *mutex, uint64_t timeout_ms) {
+    struct p7r_delegation delegation;
+    struct p7r_sync_waiter waiter;
+    p7r_sync_waiter_prepare(&waiter, &delegation, 1);
+    waiter.mutex = mutex;
+    pthread_spin_lock(&(condvar->lock));
+    list_add_tail(&(waiter.linkable), &(condvar->waiters));
+    pthread_spin_unlock(&(condvar->lock));
+    p7r_mutex_unlock(mutex);
+    if (!p7r_sync_waiter_park(&waiter, &(condvar->lock), timeout_ms)) {
+        p7r_mutex_lock(mutex);
+        return (errno = ETIMEDOUT), -1;
+    }
+    p7r_mutex_acquired(mutex, 0);
+    return 0;
+}
+
+void p7r_condvar_signal(struct p7r_condvar *condvar) {
+    pthread_spin_lock(&(condvar->lock));
+    struct p7r_sync_waiter *waiter = p7r_sync_waiter_claim(&(condvar->waiters));
+    pthread_spin_unlock(&(condvar->lock));
+    waiter && (p7r_condvar_requeue(waiter), 0);
+}
+
+void p7r_condvar_broadcast(struct p7r_condvar *condvar) {
+    list_ctl_t signalled, *p, *t;
+    init_list_head(&signalled);
+    pthread_spin_lock(&(condvar->lock));
+    for (struct p7r_sync_waiter *waiter; (waiter = p7r_sync_waiter_claim(&(condvar->waiters))) != NULL; )
+        list_add_tail(&(waiter->linkable), &signalled);
+    pthread_spin_unlock(&(condvar->lock));
+    list_foreach_remove(p, &signalled, t) {
+        list_del(t);
+        p7r_condvar_requeue(container_of(t, struct p7r_sync_waiter, linkable));
+    }
+}
+
+
+// semaphore
+
+int p7r_semaphore_init(struct p7r_semaphore *semaphore, uint64_t count) {
+    (semaphore->count = count), (semaphore->stat = NULL);
+    init_list_head(&(semaphore->waiters));
+    return pthread_spin_init(&(semaphore->lock), PTHREAD_PROCESS_PRIVATE);
+}
+
+void p7r_semaphore_ruin(struct p7r_semaphore *semaphore) {
+    pthread_spin_destroy(&(semaphore->lock));
+}
+
+int p7r_semaphore_trywait(struct p7r_semaphore *semaphore) {
+    pthread_spin_lock(&(semaphore->lock));
+    int taken = (semaphore->count != 0) && (semaphore->count--, 1);
+    pthread_spin_unlock(&(semaphore->lock));
+    if (!taken)
+        return (errno = EAGAIN), -1;
+    unlikely(semaphore->stat != NULL) && (p7r_sync_stat_acquired(semaphore->stat, 0), 0);
+    return 0;
+}
+
+int p7r_semaphore_wait(struct p7r_semaphore *semaphore, uint64_t timeout_ms) {
+    uint64_t wait_begin = 0;
+    struct p7r_delegation delegation;
+    struct p7r_sync_waiter waiter;
+    pthread_spin_lock(&(semaphore->lock));
+    if (semaphore->count) {
+        semaphore->count--;
+        pthread_spin_unlock(&(semaphore->lock));
+    } else {
+        p7r_sync_waiter_prepare(&waiter, &delegation, 0);
+        list_add_tail(&(waiter.linkable), &(semaphore->waiters));
+        pthread_spin_unlock(&(semaphore->lock));
+        wait_begin = p7r_sync_wait_begin(semaphore->stat);
+        if (!p7r_sync_waiter_park(&waiter, &(semaphore->lock), timeout_ms))
+            return (errno = ETIMEDOUT), -1;
+    }
+    unlikely(semaphore->stat != NULL) && (p7r_sync_stat_acquired(semaphore->stat, wait_begin), 0);
+    return 0;
+}
+
+void p7r_semaphore_post(struct p7r_semaphore *semaphore) {
+    pthread_spin_lock(&(semaphore->lock));
+    // the unit goes straight to the first waiter, if any
+    struct p7r_sync_waiter *waiter = p7r_sync_waiter_claim(&(semaphore->waiters));
+    waiter || (semaphore->count++, 0);
+    pthread_spin_unlock(&(semaphore->lock));
+    waiter && (p7r_sync_waiter_grant(waiter), 0);
+}
+
+void p7r_semaphore_instrument(struct p7r_semaphore *semaphore, struct p7r_sync_stat *stat) {
+    stat && memset(stat, 0, sizeof(struct p7r_sync_stat));
+    semaphore->stat = stat;
+}
+
+
+// reader-writer lock
+
+static
+void p7r_rwlock_wait(struct p7r_rwlock *rwlock, int exclusive) {
+    struct p7r_delegation delegation;
+    struct p7r_sync_waiter waiter;
+    p7r_sync_waiter_prepare(&waiter, &delegation, exclusive);
+    list_add_tail(&(waiter.linkable), &(rwlock->waiters));
+    pthread_spin_unlock(&(rwlock->lock));
+    uint64_t wait_begin = p7r_sync_wait_begin(rwlock->stat);
+    p7r_sync_waiter_park(&waiter, &(rwlock->lock), 0);
+    if (unlikely(rwlock->stat != NULL)) {
+        uint64_t acquired_at = p7r_sync_stat_acquired(rwlock->stat, wait_begin);
+        exclusive && (rwlock->acquired_at = acquired_at);
+    }
+}
+
+int p7r_rwlock_init(struct p7r_rwlock *rwlock) {
+    (rwlock->n_readers = 0), (rwlock->writer = 0), (rwlock->stat = NULL), (rwlock->acquired_at = 0);
+    init_list_head(&(rwlock->waiters));
+    return pthread_spin_init(&(rwlock->lock), PTHREAD_PROCESS_PRIVATE);
+}
+
+void p7r_rwlock_ruin(struct p7r_rwlock *rwlock) {
+    pthread_spin_destroy(&(rwlock->lock));
+}
+
+int p7r_rwlock_tryrdlock(struct p7r_rwlock *rwlock) {
+    pthread_spin_lock(&(rwlock->lock));
+    int taken = !rwlock->writer && list_is_empty(&(rwlock->waiters)) && (rwlock->n_readers++, 1);
+    pthread_spin_unlock(&(rwlock->lock));
+    if (!taken)
+        return (errno = EBUSY), -1;
+    unlikely(rwlock->stat != NULL) && (p7r_sync_stat_acquired(rwlock->stat, 0), 0);
+    return 0;
+}
+
+int p7r_rwlock_trywrlock(struct p7r_rwlock *rwlock) {
+    pthread_spin_lock(&(rwlock->lock));
+    int taken = !rwlock->writer && !rwlock->n_readers && (rwlock->writer = 1);
+    pthread_spin_unlock(&(rwlock->lock));
+    if (!taken)
+        return (errno = EBUSY), -1;
+    unlikely(rwlock->stat != NULL) && (rwlock->acquired_at = p7r_sync_stat_acquired(rwlock->stat, 0));
+    return 0;
+}
+
+void p7r_rwlock_rdlock(struct p7r_rwlock *rwlock) {
+    if (p7r_rwlock_tryrdlock(rwlock) == 0)
+        return;
+    pthread_spin_lock(&(rwlock->lock));
+    if (!rwlock->writer && list_is_empty(&(rwlock->waiters))) {
+        rwlock->n_readers++;
+        pthread_spin_unlock(&(rwlock->lock));
+        unlikely(rwlock->stat != NULL) && (p7r_sync_stat_acquired(rwlock->stat, 0), 0);
+        return;
+    }
+    p7r_rwlock_wait(rwlock, 0);
+}
+
+void p7r_rwlock_wrlock(struct p7r_rwlock *rwlock) {
+    if (p7r_rwlock_trywrlock(rwlock) == 0)
+        return;
+    pthread_spin_lock(&(rwlock->lock));
+    if (!rwlock->writer && !rwlock->n_readers) {
+        rwlock->writer = 1;
+        pthread_spin_unlock(&(rwlock->lock));
+        unlikely(rwlock->stat != NULL) && (rwlock->acquired_at = p7r_sync_stat_acquired(rwlock->stat, 0));
+        return;
+    }
+    p7r_rwlock_wait(rwlock, 1);
+}
+
+void p7r_rwlock_unlock(struct p7r_rwlock *rwlock) {
+    list_ctl_t granted, *p, *t;
+    init_list_head(&granted);
+    pthread_spin_lock(&(rwlock->lock));
+    if (rwlock->writer) {
+        rwlock->writer = 0;
+        unlikely(rwlock->stat != NULL) && (p7r_sync_stat_released(rwlock->stat, rwlock->acquired_at), 0);
+    } else
+        rwlock->n_readers--;
+    // free now - the next writer alone, or every reader up to the next writer
+    if (!rwlock->n_readers && !list_is_empty(&(rwlock->waiters))) {
+        struct p7r_sync_waiter *waiter = p7r_sync_waiter_claim(&(rwlock->waiters));
+        list_add_tail(&(waiter->linkable), &granted);
+        if (waiter->exclusive)
+            rwlock->writer = 1;
+        else {
+            rwlock->n_readers++;
+            while (!list_is_empty(&(rwlock->waiters)) &&
+                    !container_of(rwlock->waiters.next, struct p7r_sync_waiter, linkable)->exclusive) {
+                list_add_tail(&(p7r_sync_waiter_claim(&(rwlock->waiters))->linkable), &granted);
+                rwlock->n_readers++;
+            }
+        }
+    }
+    pthread_spin_unlock(&(rwlock->lock));
+    list_foreach_remove(p, &granted, t) {
+        list_del(t);
+        p7r_sync_waiter_grant(container_of(t, struct p7r_sync_waiter, linkable));
+    }
+}
+
+void p7r_rwlock_instrument(struct p7r_rwlock *rwlock, struct p7r_sync_stat *stat) {
+    stat && memset(stat, 0, sizeof(struct p7r_sync_stat));
+    rwlock->stat = stat;
+}
@@ -0,0 +1,48 @@
+#ifndef     P7R_SYNC_H_
+#define     P7R_SYNC_H_
+
+#include    "./p7r_sync_def.h"
+
+/*
+ * Blocking primitives which park uthreads instead of their carriers. Waiters queue up in arrival order, and a
+ * release hands the lock (or the semaphore unit) straight to the first of them before waking it - through u2cc
+ * when it lives on another carrier - so a woken waiter owns what it waited for and nobody barges in meanwhile.
+ * OS threads may use them as well, they sleep on a futex then.
+ *
+ * Timeouts are relative, in ms, 0 meaning none; timed calls return -1 with errno ETIMEDOUT.
+ */
+
+int p7r_mutex_init(struct p7r_mutex *mutex);
+void p7r_mutex_ruin(struct p7r_mutex *mutex);
+void p7r_mutex_lock(struct p7r_mutex *mutex);
+int p7r_mutex_trylock(struct p7r_mutex *mutex);
+void p7r_mutex_unlock(struct p7r_mutex *mutex);
+
+int p7r_condvar_init(struct p7r_condvar *condvar);
+void p7r_condvar_ruin(struct p7r_condvar *condvar);
+// returns with the mutex held either way; a signalled waiter gets it handed over without a second contention
+int p7r_condvar_wait(struct p7r_condvar *condvar, struct p7r_mutex *mutex, uint64_t timeout_ms);
+void p7r_condvar_signal(struct p7r_condvar *condvar);
+void p7r_condvar_broadcast(struct p7r_condvar *condvar);
+
+int p7r_semaphore_init(struct p7r_semaphore *semaphore, uint64_t count);
+void p7r_semaphore_ruin(struct p7r_semaphore *semaphore);
+int p7r_semaphore_wait(struct p7r_semaphore *semaphore, uint64_t timeout_ms);
+int p7r_semaphore_trywait(struct p7r_semaphore *semaphore);
+void p7r_semaphore_post(struct p7r_semaphore *semaphore);
+
+// writers are not starved: once one queues up, later readers queue behind it
+int p7r_rwlock_init(struct p7r_rwlock *rwlock);
+void p7r_rwlock_ruin(struct p7r_rwlock *rwlock);
+void p7r_rwlock_rdlock(struct p7r_rwlock *rwlock);
+void p7r_rwlock_wrlock(struct p7r_rwlock *rwlock);
+int p7r_rwlock_tryrdlock(struct p7r_rwlock *rwlock);
+int p7r_rwlock_trywrlock(struct p7r_rwlock *rwlock);
+void p7r_rwlock_unlock(struct p7r_rwlock *rwlock);
+
+// Starts collecting into stat (zeroed here), NULL stops. Not to be switched while the primitive is in use.
+void p7r_mutex_instrument(struct p7r_mutex *mutex, struct p7r_sync_stat *stat);
+void p7r_semaphore_instrument(struct p7r_semaphore *semaphore, struct p7r_sync_stat *stat);
+void p7r_rwlock_instrument(struct p7r_rwlock *rwlock, struct p7r_sync_stat *stat);
+
+#endif      // P7R_SYNC_H_
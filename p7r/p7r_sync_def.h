@@ -0,0 +1,49 @@
+#ifndef     P7R_SYNC_DEF_H_
+#define     P7R_SYNC_DEF_H_
+
+#include    "./p7r_stdc_common.h"
+#include    "./p7r_linux_common.h"
+#include    "./p7r_scraft_common.h"
+
+
+// Filled in only for primitives given one through p7r_*_instrument; times in ns.
+struct p7r_sync_stat {
+    uint64_t n_acquired, n_contended;
+    uint64_t wait_ns, max_wait_ns;
+    uint64_t hold_ns, max_hold_ns;          // exclusive holds only
+};
+
+struct p7r_mutex {
+    uint32_t state;                         // P7R_MUTEX_*
+    pthread_spinlock_t lock;                // guards waiters
+    list_ctl_t waiters;
+    struct p7r_sync_stat *stat;
+    uint64_t acquired_at;
+};
+
+#define     P7R_MUTEX_UNLOCKED          0
+#define     P7R_MUTEX_LOCKED            1
+#define     P7R_MUTEX_CONTENDED         2   // locked, somebody may be on the wait list
+
+struct p7r_condvar {
+    pthread_spinlock_t lock;
+    list_ctl_t waiters;
+};
+
+struct p7r_semaphore {
+    pthread_spinlock_t lock;
+    uint64_t count;
+    list_ctl_t waiters;
+    struct p7r_sync_stat *stat;
+};
+
+struct p7r_rwlock {
+    pthread_spinlock_t lock;
+    uint32_t n_readers;
+    int writer;
+    list_ctl_t waiters;                     // readers and writers in arrival order
+    struct p7r_sync_stat *stat;
+    uint64_t acquired_at;
+};
+
+#endif      // P7R_SYNC_DEF_H_
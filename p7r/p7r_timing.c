@@ -10,3 +10,9 @@ uint64_t get_timestamp_ms_current(void) {
 uint64_t get_timestamp_ms_by_diff(uint64_t diff) {
     return get_timestamp_ms_current() + diff;
 }
+
+uint64_t get_timestamp_ns_monotonic(void) {
+    struct timespec timeval;
+    clock_gettime(CLOCK_MONOTONIC, &timeval);
+    return ((uint64_t) timeval.tv_sec * 1000 * 1000 * 1000) + (uint64_t) timeval.tv_nsec;
+}
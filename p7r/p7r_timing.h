@@ -7,5 +7,6 @@
 
 uint64_t get_timestamp_ms_current(void);
 uint64_t get_timestamp_ms_by_diff(uint64_t diff);
+uint64_t get_timestamp_ns_monotonic(void);
 
 #endif      // P7R_TIMING_H_
@@ -0,0 +1,152 @@
+#include    <stdlib.h>
+#include    <string.h>
+#include    <time.h>
+
+#include    "./p7r_trace.h"
+
+// as P7R_MESSAGE_REAL_TYPE
+static const char *trace_message_names[] = { "undefined", "uthread request", "steal request", "steal response", "wakeup" };
+static const char *trace_left_names[] = { "yield", "block", "exit" };
+
+struct trace_slice {
+    uint64_t uthread, entrance, since;
+    uint32_t priority;
+    int open;
+};
+
+static
+uint64_t trace_now_ns(void) {
+    struct timespec timeval;
+    clock_gettime(CLOCK_MONOTONIC, &timeval);
+    return ((uint64_t) timeval.tv_sec * 1000 * 1000 * 1000) + (uint64_t) timeval.tv_nsec;
+}
+
+static
+void trace_json_string(FILE *stream, const char *string) {
+    fputc('"', stream);
+    for (; *string; string++)
+        ((*string == '"') || (*string == '\\')) ? fprintf(stream, "\\%c", *string) :
+            ((unsigned char) *string < 0x20) ? fprintf(stream, "\\u%04x", (unsigned) *string) : fputc(*string, stream);
+    fputc('"', stream);
+}
+
+static
+void trace_name_of(FILE *stream, uint64_t entrance, p7r_trace_namer_t namer, void *context) {
+    char buffer[256], address[32];
+    const char *name = NULL;
+    // only the main uthread has no entrance
+    if (entrance == 0)
+        name = "main";
+    (name == NULL) && namer && (name = namer(entrance, buffer, sizeof(buffer), context));
+    (name == NULL) && (snprintf(address, sizeof(address), "0x%lx", entrance), name = address);
+    trace_json_string(stream, name);
+}
+
+#define     trace_ts(tsc_)      (((double) ((tsc_) - segment->tsc_origin)) / ticks_per_us)
+
+static
+int64_t trace_export_ring(
+        FILE *stream, const struct p7r_trace_segment *segment, uint32_t carrier_index,
+        struct p7r_trace_event *events, double ticks_per_us, p7r_trace_namer_t namer, void *context) {
+    const struct p7r_trace_ring *ring = p7r_trace_ring_of(segment, carrier_index);
+    uint64_t n_events = segment->n_events, mask = n_events - 1;
+
+    // copy first, then drop whatever the writer may have lapped in the meantime - the slot of head is in the works
+    uint64_t head = __atomic_load_n(&(ring->head), __ATOMIC_ACQUIRE);
+    uint64_t first = (head > n_events) ? head - n_events : 0;
+    for (uint64_t index = first; index < head; index++)
+        events[index & mask] = ring->events[index & mask];
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t head_after = __atomic_load_n(&(ring->head), __ATOMIC_RELAXED);
+    (head_after >= n_events) && (head_after - n_events + 1 > first) && (first = head_after - n_events + 1);
+
+    uint64_t pid = segment->pid;
+    int64_t n_written = 0;
+    struct trace_slice slice = { .open = 0 };
+    fprintf(stream, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lu,\"tid\":%u,\"args\":{\"name\":\"carrier %u\"}}",
+            pid, carrier_index, carrier_index);
+    for (uint64_t index = first; index < head; index++) {
+        struct p7r_trace_event *event = &(events[index & mask]);
+        double ts = trace_ts(event->tsc);
+        switch (event->type) {
+            case P7R_TRACE_SWITCH_IN:
+                // the way out got lapped - close at the next way in
+                slice.open && fprintf(stream, ",\n{\"name\":\"\",\"ph\":\"E\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f}", pid, carrier_index, ts);
+                (slice.uthread = event->subject), (slice.entrance = event->detail), (slice.priority = event->argument);
+                (slice.since = event->tsc), (slice.open = 1);
+                fprintf(stream, ",\n{\"name\":");
+                trace_name_of(stream, slice.entrance, namer, context);
+                fprintf(stream, ",\"cat\":\"uthread\",\"ph\":\"B\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,"
+                        "\"args\":{\"uthread\":\"0x%lx\",\"priority\":%u}}", pid, carrier_index, ts, slice.uthread, slice.priority);
+                break;
+            case P7R_TRACE_SWITCH_OUT:
+                // without its way in, there is no slice to end
+                if (!slice.open || (slice.uthread != event->subject))
+                    continue;
+                fprintf(stream, ",\n{\"name\":\"\",\"ph\":\"E\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,\"args\":{\"left\":\"%s\"}}",
+                        pid, carrier_index, ts, trace_left_names[event->argument % 3]);
+                slice.open = 0;
+                break;
+            case P7R_TRACE_CREATE:
+                fprintf(stream, ",\n{\"name\":\"create\",\"cat\":\"sched\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,"
+                        "\"args\":{\"uthread\":\"0x%lx\",\"priority\":%u,\"entrance\":", pid, carrier_index, ts, event->subject, event->argument);
+                trace_name_of(stream, event->detail, namer, context);
+                fprintf(stream, "}}");
+                break;
+            case P7R_TRACE_BLOCK:
+                fprintf(stream, ",\n{\"name\":\"block\",\"cat\":\"sched\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,"
+                        "\"args\":{\"uthread\":\"0x%lx\",\"fd\":%d,\"events\":\"0x%x\"}}",
+                        pid, carrier_index, ts, event->subject, (int) (int64_t) event->detail, event->argument);
+                break;
+            case P7R_TRACE_WAKE:
+                fprintf(stream, ",\n{\"name\":\"wake\",\"cat\":\"sched\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,"
+                        "\"args\":{\"uthread\":\"0x%lx\"}}", pid, carrier_index, ts, event->subject);
+                break;
+            case P7R_TRACE_POST:
+            case P7R_TRACE_RECEIVE:
+                fprintf(stream, ",\n{\"name\":\"%s\",\"cat\":\"u2cc\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,"
+                        "\"args\":{\"%s\":%lu,\"message\":\"%s\",\"messages\":%u}}",
+                        (event->type == P7R_TRACE_POST) ? "post" : "receive", pid, carrier_index, ts,
+                        (event->type == P7R_TRACE_POST) ? "to" : "from", event->subject,
+                        (event->detail < 5) ? trace_message_names[event->detail] : "unknown",
+                        (event->type == P7R_TRACE_POST) ? event->argument : 1);
+                break;
+            case P7R_TRACE_BUS:
+                // recorded on the way back - the slice ends there
+                fprintf(stream, ",\n{\"name\":\"bus\",\"cat\":\"bus\",\"ph\":\"X\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"args\":{\"events\":%lu,\"timeout_ms\":%d}}",
+                        pid, carrier_index, trace_ts(event->tsc - event->detail), (double) event->detail / ticks_per_us,
+                        event->subject, (int32_t) event->argument);
+                break;
+            default:
+                continue;
+        }
+        n_written++;
+    }
+    slice.open && fprintf(stream, ",\n{\"name\":\"\",\"ph\":\"E\",\"pid\":%lu,\"tid\":%u,\"ts\":%.3f}",
+            pid, carrier_index, trace_ts(__builtin_ia32_rdtsc()));
+    return n_written;
+}
+
+int64_t p7r_trace_export_chrome(FILE *stream, const struct p7r_trace_segment *segment, p7r_trace_namer_t namer, void *context) {
+    if ((segment == NULL) || (segment->magic != P7R_TRACE_MAGIC) || (segment->version != P7R_TRACE_VERSION))
+        return -1;
+    struct p7r_trace_event *events = malloc(sizeof(struct p7r_trace_event) * segment->n_events);
+    if (events == NULL)
+        return -1;
+
+    // the TSC ticks at a constant rate on anything we run on - measured against the clock over the whole trace
+    uint64_t tsc_now = __builtin_ia32_rdtsc(), ns_now = trace_now_ns();
+    double ticks_per_us = (ns_now > segment->ns_origin) ?
+        ((double) (tsc_now - segment->tsc_origin) * 1000.0 / (double) (ns_now - segment->ns_origin)) : 1000.0;
+    (ticks_per_us <= 0) && (ticks_per_us = 1000.0);
+
+    int64_t n_written = 0;
+    fprintf(stream, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+            "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lu,\"args\":{\"name\":\"p7r %lu\"}}", segment->pid, segment->pid);
+    for (uint32_t carrier_index = 0; carrier_index < segment->n_carriers; carrier_index++)
+        n_written += trace_export_ring(stream, segment, carrier_index, events, ticks_per_us, namer, context);
+    fprintf(stream, "\n]}\n");
+    free(events);
+    return ferror(stream) ? -1 : n_written;
+}
@@ -0,0 +1,85 @@
+#ifndef     P7R_TRACE_H_
+#define     P7R_TRACE_H_
+
+#include    <stdio.h>
+#include    <stdint.h>
+
+/*
+ * Scheduler event trace, one ring per carrier, written by that carrier only - the newest n_events of each stay,
+ * older ones get overwritten. An event costs a rdtsc and a release store of the ring head; with trace.enabled off
+ * the hooks cost a test of a NULL pointer.
+ *
+ * The rings live in a memfd named P7R_TRACE_NAME, which tools/p7r_trace maps through /proc/<pid>/fd; inside the
+ * process p7r_trace_dump does the same. Either way p7r_trace_export_chrome turns them into Chrome trace JSON, as
+ * chrome://tracing and Perfetto read it: a track per carrier, a slice per stretch a uthread ran, instants between.
+ * This header and p7r_trace.c are all a reader needs.
+ */
+
+#define     P7R_TRACE_NAME              "p7r_trace"
+#define     P7R_TRACE_MAGIC             UINT64_C(0x6563617274723770)
+#define     P7R_TRACE_VERSION           1
+
+#define     P7R_TRACE_DEFAULT_EVENTS    (1 << 16)       // per carrier
+
+// subject, detail, argument of each
+#define     P7R_TRACE_CREATE            1               // uthread, entrance, priority - reincarnations included
+#define     P7R_TRACE_SWITCH_IN         2               // uthread, entrance, priority
+#define     P7R_TRACE_SWITCH_OUT        3               // uthread, -, P7R_TRACE_LEFT_*
+#define     P7R_TRACE_BLOCK             4               // uthread, fd or -1, P7R_DELEGATION_* events
+#define     P7R_TRACE_WAKE              5               // uthread, -, -
+#define     P7R_TRACE_POST              6               // destination carrier, message type, messages
+#define     P7R_TRACE_RECEIVE           7               // source carrier, message type, -
+#define     P7R_TRACE_BUS               8               // events returned, ticks spent waiting, timeout in ms
+#define     P7R_TRACE_N_TYPES           9
+
+#define     P7R_TRACE_LEFT_YIELD        0
+#define     P7R_TRACE_LEFT_BLOCK        1
+#define     P7R_TRACE_LEFT_EXIT         2
+
+struct p7r_trace_event {
+    uint64_t tsc;
+    uint64_t subject, detail;
+    uint32_t type, argument;
+};
+
+struct p7r_trace_ring {
+    uint64_t head;                      // events ever recorded - event i sits in events[i & mask]
+    uint64_t mask;
+    struct p7r_trace_event events[];
+} __attribute__((aligned(64)));
+
+struct p7r_trace_segment {
+    uint64_t magic;
+    uint32_t version, n_carriers;
+    uint64_t pid;
+    uint64_t n_events;                  // per ring, a power of 2
+    uint64_t tsc_origin, ns_origin;     // read together at init - CLOCK_MONOTONIC ns, time zero of the trace
+} __attribute__((aligned(64)));
+
+#define     P7R_TRACE_RING_SIZE(n_events_)  \
+    (sizeof(struct p7r_trace_ring) + sizeof(struct p7r_trace_event) * (n_events_))
+#define     P7R_TRACE_SEGMENT_SIZE(n_carriers_, n_events_)  \
+    (sizeof(struct p7r_trace_segment) + P7R_TRACE_RING_SIZE(n_events_) * (n_carriers_))
+
+static inline
+struct p7r_trace_ring *p7r_trace_ring_of(const struct p7r_trace_segment *segment, uint32_t carrier_index) {
+    return (struct p7r_trace_ring *) (((char *) segment) + sizeof(struct p7r_trace_segment) + P7R_TRACE_RING_SIZE(segment->n_events) * carrier_index);
+}
+
+static inline
+void p7r_trace_record(struct p7r_trace_ring *ring, uint32_t type, uint64_t subject, uint64_t detail, uint32_t argument) {
+    uint64_t head = ring->head;
+    struct p7r_trace_event *event = &(ring->events[head & ring->mask]);
+    (event->tsc = __builtin_ia32_rdtsc()), (event->subject = subject), (event->detail = detail);
+    (event->type = type), (event->argument = argument);
+    __atomic_store_n(&(ring->head), head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Names an entrance into buffer, or returns NULL to have it shown as an address. Events overwritten while being
+ * read are dropped, so a running process can be exported too. Returns the number of events written, -1 on errors.
+ */
+typedef const char *(*p7r_trace_namer_t)(uint64_t entrance, char *buffer, size_t size, void *context);
+int64_t p7r_trace_export_chrome(FILE *stream, const struct p7r_trace_segment *segment, p7r_trace_namer_t namer, void *context);
+
+#endif      // P7R_TRACE_H_
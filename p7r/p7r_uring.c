@@ -0,0 +1,94 @@
+#include    "./p7r_uring.h"
+
+#include    <sys/syscall.h>
+#include    <signal.h>
+
+
+static inline
+int p7r_uring_setup(uint32_t n_entries, struct io_uring_params *params) {
+    return (int) syscall(__NR_io_uring_setup, n_entries, params);
+}
+
+static inline
+int p7r_uring_enter_raw(int fd, uint32_t n_submit, uint32_t n_wait, uint32_t flags, void *argument, size_t argument_size) {
+    return (int) syscall(__NR_io_uring_enter, fd, n_submit, n_wait, flags, argument, argument_size);
+}
+
+struct p7r_uring *p7r_uring_init(struct p7r_uring *ring, uint32_t n_entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(struct io_uring_params));
+    memset(ring, 0, sizeof(struct p7r_uring));
+    if ((ring->fd = p7r_uring_setup(n_entries ? n_entries : P7R_URING_DEFAULT_ENTRIES, &params)) < 0)
+        return NULL;
+    if ((params.features & (IORING_FEAT_SINGLE_MMAP|IORING_FEAT_NODROP|IORING_FEAT_EXT_ARG)) !=
+            (IORING_FEAT_SINGLE_MMAP|IORING_FEAT_NODROP|IORING_FEAT_EXT_ARG)) {
+        close(ring->fd);
+        return NULL;
+    }
+
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    (ring->sq_ring_size < ring->cq_ring_size) && (ring->sq_ring_size = ring->cq_ring_size);
+    ring->cq_ring_size = ring->sq_ring_size;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        close(ring->fd);
+        return NULL;
+    }
+    ring->cq_ring = ring->sq_ring;      // IORING_FEAT_SINGLE_MMAP
+    ring->sq.sqes = mmap(NULL, ring->sqes_size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sq.sqes == MAP_FAILED) {
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        return NULL;
+    }
+
+    char *sq_ring = ring->sq_ring, *cq_ring = ring->cq_ring;
+    (ring->sq.head = (uint32_t *) (sq_ring + params.sq_off.head)), (ring->sq.tail = (uint32_t *) (sq_ring + params.sq_off.tail));
+    (ring->sq.mask = (uint32_t *) (sq_ring + params.sq_off.ring_mask)), (ring->sq.array = (uint32_t *) (sq_ring + params.sq_off.array));
+    (ring->sq.n_entries = params.sq_entries), (ring->sq.n_queued = 0);
+    (ring->cq.head = (uint32_t *) (cq_ring + params.cq_off.head)), (ring->cq.tail = (uint32_t *) (cq_ring + params.cq_off.tail));
+    ring->cq.mask = (uint32_t *) (cq_ring + params.cq_off.ring_mask);
+    ring->cq.cqes = (struct io_uring_cqe *) (cq_ring + params.cq_off.cqes);
+    return ring;
+}
+
+void p7r_uring_ruin(struct p7r_uring *ring) {
+    munmap(ring->sq.sqes, ring->sqes_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+struct io_uring_sqe *p7r_uring_sqe(struct p7r_uring *ring) {
+    uint32_t tail = *(ring->sq.tail);
+    if (tail - __atomic_load_n(ring->sq.head, __ATOMIC_ACQUIRE) >= ring->sq.n_entries) {
+        p7r_uring_enter(ring, 0);
+        if (tail - __atomic_load_n(ring->sq.head, __ATOMIC_ACQUIRE) >= ring->sq.n_entries)
+            return NULL;
+    }
+    uint32_t index = tail & *(ring->sq.mask);
+    struct io_uring_sqe *sqe = &(ring->sq.sqes[index]);
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    ring->sq.array[index] = index;
+    __atomic_store_n(ring->sq.tail, tail + 1, __ATOMIC_RELEASE);
+    ring->sq.n_queued++;
+    return sqe;
+}
+
+int p7r_uring_enter(struct p7r_uring *ring, int64_t timeout_ns) {
+    if (!ring->sq.n_queued && !timeout_ns)
+        return 0;
+    struct __kernel_timespec timeval = { .tv_sec = timeout_ns / 1000000000, .tv_nsec = timeout_ns % 1000000000 };
+    struct io_uring_getevents_arg argument = { .sigmask = 0, .sigmask_sz = _NSIG / 8, .ts = (timeout_ns < 0) ? 0 : (uint64_t) &timeval };
+    int n_submitted = timeout_ns ?
+        p7r_uring_enter_raw(ring->fd, ring->sq.n_queued, 1, IORING_ENTER_GETEVENTS|IORING_ENTER_EXT_ARG, &argument, sizeof(argument)) :
+        p7r_uring_enter_raw(ring->fd, ring->sq.n_queued, 0, 0, NULL, 0);
+    if (n_submitted >= 0) {
+        ring->sq.n_queued -= n_submitted;
+        return 0;
+    }
+    // timed out or interrupted - completions, if any, are in the ring anyway
+    return ((errno == ETIME) || (errno == EINTR) || (errno == EBUSY)) ? 0 : -1;
+}
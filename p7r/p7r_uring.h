@@ -0,0 +1,56 @@
+#ifndef     P7R_URING_H_
+#define     P7R_URING_H_
+
+#include    "./p7r_stdc_common.h"
+#include    "./p7r_linux_common.h"
+
+#include    <linux/io_uring.h>
+
+/*
+ * Bare io_uring instance for the scheduler bus, driven through raw syscalls.
+ *
+ * Submissions are queued in the shared ring without a syscall and go to the kernel with the next wait, which also
+ * carries the wait timeout (IORING_ENTER_EXT_ARG), so a refresh which finds nothing to submit and nothing to wait
+ * for never leaves user space. Kernels lacking EXT_ARG or NODROP are treated as having no io_uring at all.
+ */
+
+struct p7r_uring {
+    int fd;
+    struct {
+        uint32_t *head, *tail, *mask, *array;
+        struct io_uring_sqe *sqes;
+        uint32_t n_entries, n_queued;
+    } sq;
+    struct {
+        uint32_t *head, *tail, *mask;
+        struct io_uring_cqe *cqes;
+    } cq;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+};
+
+#define     P7R_URING_DEFAULT_ENTRIES       256
+
+struct p7r_uring *p7r_uring_init(struct p7r_uring *ring, uint32_t n_entries);
+void p7r_uring_ruin(struct p7r_uring *ring);
+
+// Returns a zeroed submission entry, flushing the queue to the kernel first if it is full.
+struct io_uring_sqe *p7r_uring_sqe(struct p7r_uring *ring);
+
+// Submits everything queued; waits for at least one completion unless timeout_ns is 0, forever if it is -1.
+int p7r_uring_enter(struct p7r_uring *ring, int64_t timeout_ns);
+
+static inline
+struct io_uring_cqe *p7r_uring_cqe_peek(struct p7r_uring *ring) {
+    uint32_t head = *(ring->cq.head);
+    if (head == __atomic_load_n(ring->cq.tail, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &(ring->cq.cqes[head & *(ring->cq.mask)]);
+}
+
+static inline
+void p7r_uring_cqe_seen(struct p7r_uring *ring) {
+    __atomic_store_n(ring->cq.head, *(ring->cq.head) + 1, __ATOMIC_RELEASE);
+}
+
+#endif      // P7R_URING_H_
@@ -1,20 +1,30 @@
+#define     _GNU_SOURCE             // accept4
+
 #include    "./p7r_uthread.h"
 #include    "./p7r_root_alloc.h"
 #include    "./p7r_timing.h"
 
+#include    <dlfcn.h>
+
 
 #define p7r_uthread_reenable(scheduler_, uthread_) \
     do { \
         __auto_type uthread__ = (uthread_); \
         if (uthread__->status != P7R_UTHREAD_RUNNING) { \
             p7r_uthread_detach(uthread__); \
-            p7r_uthread_attach(uthread__, &((scheduler_)->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING])); \
+            sched_trace((scheduler_), P7R_TRACE_WAKE, uthread__, 0, 0); \
+            sched_runnable_enqueue((scheduler_), uthread__); \
             p7r_uthread_change_state_clean(uthread__, P7R_UTHREAD_RUNNING); \
         } \
     } while (0)
 
+// single writer per carrier - a relaxed store, never a locked instruction
+#define     sched_count_add(scheduler_, counter_, n_) \
+    __atomic_store_n(&((scheduler_)->counters->counter_), (scheduler_)->counters->counter_ + (n_), __ATOMIC_RELAXED)
+#define     sched_count(scheduler_, counter_)   sched_count_add(scheduler_, counter_, 1)
 
-#define CP_BUFFER_RETRY_TIMES       5
+#define     sched_trace(scheduler_, type_, subject_, detail_, argument_) \
+    ((scheduler_)->trace && (p7r_trace_record((scheduler_)->trace, (type_), (uint64_t) (subject_), (uint64_t) (detail_), (argument_)), 0))
 
 
 // globals
@@ -23,9 +33,23 @@ static struct p7r_scheduler *schedulers;
 static struct p7r_carrier *carriers;
 static pthread_barrier_t carrier_barrier;
 static __thread struct p7r_carrier *self_carrier;
-static struct p7r_uthread main_uthread = { .scheduler_index = 0, .status = P7R_UTHREAD_RUNNING };
+static struct p7r_uthread main_uthread = { .scheduler_index = 0, .status = P7R_UTHREAD_RUNNING, .priority = P7R_PRIORITY_NORMAL };
 static uint32_t balance_index = 0;
 static volatile uint32_t n_carriers = 1;
+static struct p7r_counters_segment *counters_segment;
+static struct p7r_trace_segment *trace_segment;
+static uint32_t placement_round_robin(struct p7r_scheduler *local);
+static inline uint32_t placement_unparked(uint32_t index);
+static struct {
+    uint32_t (*target_of)(struct p7r_scheduler *local);
+    uint32_t saturation;
+} placement = { .target_of = placement_round_robin, .saturation = P7R_PLACEMENT_DEFAULT_SATURATION };
+static struct {
+    uint32_t n_parked;                  // peeked before anything else - 0 most of the time
+    uint32_t min_unparked, unpark_depth;
+} elastic = { .n_parked = 0, .min_unparked = 1, .unpark_depth = P7R_ELASTIC_DEFAULT_UNPARK_DEPTH };
+static __thread uint32_t placement_seed = 0;
+static __thread uint32_t foreign_balance_index = UINT32_MAX;
 
 #define next_balance_index __atomic_add_fetch(&balance_index, 1, __ATOMIC_ACQ_REL)
 
@@ -41,8 +65,7 @@ uint32_t p7r_n_carriers(void) {
 }
 
 uint32_t balanced_target_carrier(void) {
-    // TODO rewrite
-    return next_balance_index % p7r_n_carriers();
+    return placement_unparked(placement.target_of(self_carrier ? self_carrier->scheduler : NULL));
 }
 
 
@@ -98,8 +121,13 @@ static struct p7r_uthread *sched_resched_target(struct p7r_scheduler *scheduler)
 static struct p7r_uthread_request sched_cherry_pick(struct p7r_scheduler *scheduler);
 
 static void sched_idle(struct p7r_uthread *uthread);
+static void sched_steal(struct p7r_scheduler *scheduler);
+static void sched_delegation_wake(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation);
+static inline void p7r_u2cc_knock(struct p7r_scheduler *destination);
 
 static void p7r_internal_message_delete(struct p7r_internal_message *message);
+static struct p7r_internal_message *p7r_u2cc_message_raw(uint64_t base_type, size_t size_hint);
+static void p7r_u2cc_message_post(uint32_t dst_index, uint32_t src_index, struct p7r_internal_message *message);
 
 static inline
 struct p7r_uthread_request *p7r_uthread_request_init(
@@ -134,6 +162,14 @@ void p7r_uthread_change_state_clean(struct p7r_uthread *uthread, uint64_t status
 
 static inline
 void p7r_uthread_switch(struct p7r_uthread *to, struct p7r_uthread *from) {
+    struct p7r_scheduler *scheduler = &(schedulers[to->scheduler_index]);
+    sched_count(scheduler, n_switches);
+    if (unlikely(scheduler->trace != NULL)) {
+        uint32_t left = (from->status == P7R_UTHREAD_BLOCKING) ? P7R_TRACE_LEFT_BLOCK :
+            (from->status == P7R_UTHREAD_RUNNING) ? P7R_TRACE_LEFT_YIELD : P7R_TRACE_LEFT_EXIT;
+        p7r_trace_record(scheduler->trace, P7R_TRACE_SWITCH_OUT, (uint64_t) from, 0, left);
+        p7r_trace_record(scheduler->trace, P7R_TRACE_SWITCH_IN, (uint64_t) to, (uint64_t) to->entrance.user_entrance, to->priority);
+    }
     p7r_context_switch(&(to->context), &(from->context));
 }
 
@@ -147,19 +183,237 @@ void p7r_uthread_attach(struct p7r_uthread *uthread, list_ctl_t *target) {
     list_add_tail(&(uthread->linkable), target);
 }
 
+// load bookkeeping - counters are written by the owner only and peeked by peers
+
+static inline
+void sched_load_publish(uint32_t *counter, uint32_t value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
+
+static inline
+uint32_t sched_load_peek(uint32_t *counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+static inline
+void sched_runnable_enqueue(struct p7r_scheduler *scheduler, struct p7r_uthread *uthread) {
+    p7r_uthread_attach(uthread, &(scheduler->runners.sched_queues[P7R_SCHED_RUN_QUEUE(uthread->priority)]));
+    sched_load_publish(&(scheduler->load.n_runnable), scheduler->load.n_runnable + 1);
+}
+
+static inline
+void sched_runnable_dequeue(struct p7r_scheduler *scheduler, struct p7r_uthread *uthread) {
+    p7r_uthread_detach(uthread);
+    sched_load_publish(&(scheduler->load.n_runnable), scheduler->load.n_runnable - 1);
+}
+
+static inline
+void sched_fresh_adjust(struct p7r_scheduler *scheduler, int delta) {
+    sched_load_publish(&(scheduler->load.n_fresh), scheduler->load.n_fresh + delta);
+}
+
+static inline
+void sched_request_enqueue(struct p7r_scheduler *scheduler, struct p7r_uthread_request *request) {
+    list_add_tail(&(request->linkable), &(scheduler->runners.request_queues[request->priority]));
+    sched_load_publish(&(scheduler->load.n_requests), scheduler->load.n_requests + 1);
+}
+
+static inline
+void sched_request_dequeue(struct p7r_scheduler *scheduler, struct p7r_uthread_request *request) {
+    list_del(&(request->linkable));
+    sched_load_publish(&(scheduler->load.n_requests), scheduler->load.n_requests - 1);
+}
+
+static inline
+int sched_runnable_any(struct p7r_scheduler *scheduler) {
+    for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++)
+        if (!list_is_empty(&(scheduler->runners.sched_queues[P7R_SCHED_RUN_QUEUE(priority)])))
+            return 1;
+    return 0;
+}
+
+static inline
+int sched_requests_any(struct p7r_scheduler *scheduler) {
+    return scheduler->load.n_requests != 0;
+}
+
+// what a new uthread or request runs at, P7R_PRIORITY_INHERIT resolved
+static inline
+uint32_t sched_priority_of_spawn(uint32_t priority) {
+    if (priority == P7R_PRIORITY_INHERIT)
+        return p7r_in_uthread() ? self_carrier->scheduler->runners.running->priority : P7R_PRIORITY_NORMAL;
+    return (priority < P7R_N_PRIORITIES) ? priority : P7R_PRIORITY_BACKGROUND;
+}
+
+static inline
+uint32_t sched_queue_depth(struct p7r_scheduler *scheduler) {
+    return sched_load_peek(&(scheduler->load.n_runnable)) + sched_load_peek(&(scheduler->load.n_requests));
+}
+
+static inline
+void sched_idleness_account(struct p7r_scheduler *scheduler, uint64_t idle_ns, uint64_t current_ns) {
+    scheduler->load.idle_ns += idle_ns;
+    uint64_t window = current_ns - scheduler->load.window_start;
+    if (window >= P7R_LOAD_WINDOW_NS) {
+        uint64_t idle_permille = scheduler->load.idle_ns * 1000 / window;
+        sched_load_publish(&(scheduler->load.idle_permille), (idle_permille > 1000) ? 1000 : idle_permille);
+        (scheduler->load.window_start = current_ns), (scheduler->load.idle_ns = 0);
+    }
+}
+
+// placement - where new uthreads go, `local` is NULL outside carriers
+
+static inline
+uint32_t placement_random(void) {
+    // xorshift32 - a private stream per thread, no shared cache line to bounce
+    uint32_t x = placement_seed;
+    (x == 0) && (x = (uint32_t) (uintptr_t) &placement_seed ^ (uint32_t) get_timestamp_ns_monotonic(), x |= 1);
+    (x ^= x << 13), (x ^= x >> 17), (x ^= x << 5);
+    return placement_seed = x;
+}
+
+static
+uint32_t placement_round_robin(struct p7r_scheduler *local) {
+    if (local)
+        return next_balance_index % p7r_n_carriers();
+    // every foreign submitter walks the carriers on its own, from a random start - a shared cursor would be one
+    // more cache line all of them fight over
+    (foreign_balance_index == UINT32_MAX) && (foreign_balance_index = placement_random());
+    return foreign_balance_index++ % p7r_n_carriers();
+}
+
+static inline
+uint64_t placement_score(struct p7r_scheduler *scheduler) {
+    // queue depth first, the busier of two equally deep carriers loses
+    return ((uint64_t) sched_queue_depth(scheduler) << 16) | (1000 - sched_load_peek(&(scheduler->load.idle_permille)));
+}
+
+static
+uint32_t placement_load_aware(struct p7r_scheduler *local) {
+    if (local && (sched_queue_depth(local) < placement.saturation))
+        return local->index;
+    uint32_t n = p7r_n_carriers();
+    if (n == 1)
+        return 0;
+    // power of two choices
+    uint32_t lhs = placement_random() % n, rhs = placement_random() % (n - 1);
+    (rhs >= lhs) && (rhs++);
+    return (placement_score(&(schedulers[lhs])) <= placement_score(&(schedulers[rhs]))) ? lhs : rhs;
+}
+
+// The carrier itself, or the next one up if it is parked - carrier 0 never parks, so there always is one.
+static inline
+uint32_t placement_unparked(uint32_t index) {
+    if (likely(__atomic_load_n(&(elastic.n_parked), __ATOMIC_RELAXED) == 0))
+        return index;
+    while (__atomic_load_n(&(schedulers[index].elastic.parked), __ATOMIC_RELAXED))
+        index = (index + 1) % p7r_n_carriers();
+    return index;
+}
+
+static
+uint32_t (*p7r_placement_policies[P7R_N_PLACEMENT_POLICIES])(struct p7r_scheduler *) = {
+    [P7R_PLACEMENT_ROUND_ROBIN] = placement_round_robin,
+    [P7R_PLACEMENT_LOAD_AWARE] = placement_load_aware,
+};
+
+// stack placement - which zone a stack comes from, learnt per carrier from how long its entrance lives
+
+#define     sched_stack_hints_tracked(scheduler_)       \
+    ((scheduler_)->policy.stack_placement.adaptive || (scheduler_)->policy.stack_placement.profile)
+
+// what the lifespan itself may still write above its own frame while repainting
+#define     P7R_STACK_PAINT_SLACK           1024
+
+static
+int sched_stack_hints_init(struct p7r_scheduler *scheduler, uint32_t n_hints) {
+    return p7r_stack_hint_dictionary_init(
+            &(scheduler->runners.stack_hints),
+            n_hints ? n_hints : P7R_STACK_HINT_DEFAULT_CAPACITY,
+            &(scheduler->runners.stack_allocator)
+    ) ? 0 : -1;
+}
+
+// NULL unless placement is adaptive - or once as many entrances as we care to track have shown up
+static
+struct p7r_stack_hint *sched_stack_hint_of(struct p7r_scheduler *scheduler, void (*entrance)(void *)) {
+    struct p7r_stack_hint_dictionary *hints = &(scheduler->runners.stack_hints);
+    if (!sched_stack_hints_tracked(scheduler))
+        return NULL;
+    struct p7r_stack_hint *hint = p7r_stack_hint_dictionary_get_by_entrance(hints, entrance);
+    if (likely(hint != NULL) || (hints->n_hints >= hints->capacity))
+        return hint;
+    struct p7r_stack_hint_config config = { .failure_stat = { .measure_limit = P7R_STACK_HINT_FAILURE_WINDOW } };
+    if (((hint = p7r_stack_hint_new_from_entrance(entrance, config)) != NULL) && !p7r_stack_hint_dictionary_put(hints, hint))
+        p7r_stack_hint_delete(hint), (hint = NULL);
+    return hint;
+}
+
+static inline
+void sched_stack_hint_feed(struct p7r_scheduler *scheduler, struct p7r_uthread *uthread) {
+    p7r_stack_hint_record_lifetime(uthread->hint, (get_timestamp_ns_monotonic() - uthread->launched_at) / 1000.0);
+    scheduler->policy.stack_placement.adaptive &&
+        (p7r_stack_hint_adapt(uthread->hint, scheduler->policy.stack_placement.eden_below_us, scheduler->policy.stack_placement.prudent_above_us), 0);
+}
+
+// Runs on the measured stack itself, so the repaint stops short of the current frame. Repaints whether or not the
+// entrance has a hint to record into - the next user of a dirty stack counts on it.
+static
+void sched_stack_depth_feed(struct p7r_uthread *uthread) {
+    char anchor;
+    struct p7r_stack_metamark *mark = uthread->stack_metamark;
+    char *top = stack_base_of(mark) + stack_size_of(mark);
+    char *deepest = p7r_stack_deepest(mark);
+    char *limit = (char *) (((uintptr_t) &anchor - P7R_STACK_PAINT_SLACK) & ~((uintptr_t) sizeof(uint64_t) - 1));
+    if (uthread->hint)
+        p7r_stack_hint_record_depth(uthread->hint, top - deepest), p7r_stack_hint_fit(uthread->hint, mark->provider->parent);
+    (deepest < limit) && (p7r_stack_paint(deepest, limit), 0);
+}
+
+static
+struct p7r_uthread *sched_uthread_from_request(struct p7r_scheduler *scheduler, struct p7r_uthread_request request, uint8_t stack_alloc_policy);
+
+static inline
+uint32_t sched_stack_class_of(struct p7r_scheduler *scheduler, uint32_t stack_class, struct p7r_stack_hint *hint) {
+    (stack_class == P7R_STACK_CLASS_AUTO) && (stack_class = hint ? hint->size_class : P7R_STACK_CLASS_DEFAULT);
+    return p7r_stack_size_class_of(&(scheduler->runners.stack_allocator), stack_class)->index;
+}
+
+static inline
+int sched_stack_fits(struct p7r_scheduler *scheduler, struct p7r_uthread *uthread, struct p7r_uthread_request *request) {
+    struct p7r_stack_hint *hint = (request->stack_class == P7R_STACK_CLASS_AUTO) ? sched_stack_hint_of(scheduler, request->user_entrance) : NULL;
+    return sched_stack_class_of(scheduler, request->stack_class, hint) == uthread->stack_metamark->provider->size_class->index;
+}
+
 static
 void p7r_uthread_lifespan(void *uthread_) {
     struct p7r_uthread *self = uthread_;
 
     struct p7r_uthread_request reincarnation;
     struct p7r_scheduler *self_scheduler = &(schedulers[self->scheduler_index]);
+    sched_fresh_adjust(self_scheduler, -1);
     do {
         p7r_uthread_change_state_clean(self, P7R_UTHREAD_RUNNING);
+        self->hint && (self->launched_at = get_timestamp_ns_monotonic());
         self->entrance.user_entrance(self->entrance.user_argument);
+        self->hint && (sched_stack_hint_feed(self_scheduler, self), 0);
+        unlikely(self->stack_metamark->provider->parent->properties.high_water_profile) && (sched_stack_depth_feed(self), 0);
         p7r_uthread_change_state_clean(self, P7R_UTHREAD_LIMBO);
         reincarnation = sched_cherry_pick(self_scheduler);
+        if (reincarnation.user_entrance && !sched_stack_fits(self_scheduler, self, &reincarnation)) {
+            // wants a stack of another size - give it one, and retire ours
+            struct p7r_uthread *uthread = sched_uthread_from_request(self_scheduler, reincarnation, P7R_STACK_POLICY_DEFAULT);
+            uthread && (sched_runnable_enqueue(self_scheduler, uthread), 0);
+            reincarnation.user_entrance = NULL;
+        }
         if (reincarnation.user_entrance) {
+            // the stack stays where it is, the new entrance still gets measured
+            self->hint = sched_stack_hint_of(self_scheduler, reincarnation.user_entrance);
             (self->entrance.user_entrance = reincarnation.user_entrance), (self->entrance.user_argument = reincarnation.user_argument);
+            (self->entrance.user_argument_dtor = reincarnation.user_argument_dtor), (self->future = reincarnation.future);
+            self->priority = reincarnation.priority;
+            sched_count(self_scheduler, n_reincarnated);
+            sched_trace(self_scheduler, P7R_TRACE_CREATE, self, reincarnation.user_entrance, self->priority);
             {
                 sched_bus_refresh(self_scheduler);
                 struct p7r_uthread *next_balance = sched_resched_target(self_scheduler);
@@ -168,10 +422,11 @@ void p7r_uthread_lifespan(void *uthread_) {
         }
     } while (reincarnation.user_entrance);
 
-    p7r_uthread_detach(self);
+    sched_runnable_dequeue(self_scheduler, self);
     p7r_uthread_change_state_clean(self, P7R_UTHREAD_DYING);
     list_add_tail(&(self->linkable), &(schedulers[self->scheduler_index].runners.sched_queues[P7R_SCHED_QUEUE_DYING]));
     schedulers[self->scheduler_index].runners.running = NULL;
+    sched_trace(self_scheduler, P7R_TRACE_SWITCH_OUT, self, 0, P7R_TRACE_LEFT_EXIT);
 
     // Actually we never return, but that's one of things we would not tell the compiler
     p7r_context_switch(schedulers[self->scheduler_index].runners.carrier_context, &(self->context));
@@ -186,7 +441,10 @@ struct p7r_uthread *p7r_uthread_init(
         struct p7r_stack_metamark *stack_metamark) {
     uthread->scheduler_index = scheduler_index;
     uthread->stack_metamark = stack_metamark;
+    uthread->status = P7R_UTHREAD_PRELAUNCH;
     (uthread->entrance.user_entrance = user_entrance), (uthread->entrance.user_argument = user_argument);
+    (uthread->future = NULL), (uthread->entrance.user_argument_dtor = NULL);
+    (uthread->hint = NULL), (uthread->launched_at = 0), (uthread->priority = P7R_PRIORITY_NORMAL);
     (uthread->entrance.real_entrance = p7r_uthread_lifespan), (uthread->entrance.real_argument = uthread);
     p7r_context_init(&(uthread->context), stack_base_of(stack_metamark), stack_size_of(stack_metamark));
     p7r_context_prepare(&(uthread->context), uthread->entrance.real_entrance, uthread->entrance.real_argument);
@@ -205,12 +463,18 @@ struct p7r_uthread *p7r_uthread_new(
         void (*user_entrance)(void *), 
         void *user_argument, 
         struct p7r_stack_allocator *allocator, 
-        uint8_t stack_alloc_policy) {
-    struct p7r_stack_metamark *stack_meta = stack_metamark_create(allocator, stack_alloc_policy);
+        uint32_t stack_class,
+        uint8_t stack_alloc_policy,
+        struct p7r_stack_hint *hint) {
+    struct p7r_stack_metamark *stack_meta = hint ? 
+        stack_metamark_create_hinted(allocator, stack_class, hint) : 
+        stack_metamark_create(allocator, (stack_class == P7R_STACK_CLASS_AUTO) ? P7R_STACK_CLASS_DEFAULT : stack_class, stack_alloc_policy);
     if (unlikely(stack_meta == NULL)) 
         return NULL;
     struct p7r_uthread *uthread = (struct p7r_uthread *) stack_meta_of(stack_meta);
-    return p7r_uthread_init(uthread, scheduler_index, user_entrance, user_argument, stack_meta);
+    p7r_uthread_init(uthread, scheduler_index, user_entrance, user_argument, stack_meta);
+    uthread->hint = hint;
+    return uthread;
 }
 
 static inline
@@ -222,14 +486,424 @@ void p7r_uthread_delete(struct p7r_uthread *uthread) {
 static
 void u2cc_handler_uthread_request(struct p7r_scheduler *scheduler, struct p7r_internal_message *message) {
     struct p7r_uthread_request *request = (struct p7r_uthread_request *) &(message->content_buffer);
-    list_add_tail(&(request->linkable), &(scheduler->runners.request_queue));
+    sched_request_enqueue(scheduler, request);
+}
+
+static
+void u2cc_handler_steal_request(struct p7r_scheduler *scheduler, struct p7r_internal_message *message) {
+    uint32_t thief_index = message->from;
+    uint32_t n_stealable = scheduler->load.n_requests + scheduler->load.n_fresh;
+    uint32_t n_to_steal = (n_stealable + 1) / 2, n_stolen = 0;
+
+    // oldest pending requests first, the urgent ones before them - the thief is idle, they would wait the longest here
+    for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++) {
+        list_ctl_t *request_queue = &(scheduler->runners.request_queues[priority]);
+        while ((n_stolen < n_to_steal) && !list_is_empty(request_queue)) {
+            struct p7r_uthread_request *request = container_of(request_queue->next, struct p7r_uthread_request, linkable);
+            sched_request_dequeue(scheduler, request);
+            p7r_u2cc_message_post(thief_index, scheduler->index, P7R_MESSAGE_OF(request));
+            n_stolen++;
+        }
+    }
+
+    // uthreads which have never been switched to own nothing but a stack of ours - turn them back into requests
+    list_ctl_t *p, *t;
+    uint32_t n_scanned = 0;
+    for (uint32_t priority = 0; (priority < P7R_N_PRIORITIES) && (n_stolen < n_to_steal); priority++) {
+        list_foreach_remove(p, &(scheduler->runners.sched_queues[P7R_SCHED_RUN_QUEUE(priority)]), t) {
+            if ((n_stolen >= n_to_steal) || (n_scanned++ >= P7R_STEAL_MAX_PRELAUNCH_SCAN))
+                break;
+            struct p7r_uthread *uthread = container_of(t, struct p7r_uthread, linkable);
+            if ((uthread == scheduler->runners.running) || (uthread->status != P7R_UTHREAD_PRELAUNCH))
+                continue;
+            struct p7r_internal_message *request_message = p7r_u2cc_message_raw(P7R_MESSAGE_UTHREAD_REQUEST, sizeof(struct p7r_uthread_request));
+            if (unlikely(request_message == NULL))
+                break;
+            struct p7r_uthread_request *request = (struct p7r_uthread_request *) &(request_message->content_buffer);
+            (request->user_entrance = uthread->entrance.user_entrance), (request->user_argument = uthread->entrance.user_argument);
+            (request->user_argument_dtor = uthread->entrance.user_argument_dtor), (request->future = uthread->future);
+            (request->stack_class = uthread->stack_metamark->provider->size_class->index), (request->priority = uthread->priority);
+            sched_runnable_dequeue(scheduler, uthread);
+            sched_fresh_adjust(scheduler, -1);
+            p7r_uthread_delete(uthread);
+            p7r_u2cc_message_post(thief_index, scheduler->index, request_message);
+            n_stolen++;
+        }
+    }
+
+    // the same message goes back behind everything stolen - the inbox keeps per-producer order
+    message->type = P7R_MESSAGE_STEAL_RESPONSE|P7R_INTERNAL_U2CC;
+    p7r_u2cc_message_post(thief_index, scheduler->index, message);
+}
+
+static
+void u2cc_handler_steal_response(struct p7r_scheduler *scheduler, struct p7r_internal_message *message) {
+    scheduler->bus.stealing = 0;
+    p7r_internal_message_delete(message);
+}
+
+static
+void u2cc_handler_wakeup(struct p7r_scheduler *scheduler, struct p7r_internal_message *message) {
+    // the message is the waiter's own - nothing to give back
+    sched_delegation_wake(scheduler, container_of(message, struct p7r_delegation, checked_events.oob.wakeup));
 }
 
 static
 void (*p7r_internal_handlers[])(struct p7r_scheduler *, struct p7r_internal_message *) = {
-    [1] = u2cc_handler_uthread_request,
+    [P7R_MESSAGE_REAL_TYPE(P7R_MESSAGE_UTHREAD_REQUEST)] = u2cc_handler_uthread_request,
+    [P7R_MESSAGE_REAL_TYPE(P7R_MESSAGE_STEAL_REQUEST)] = u2cc_handler_steal_request,
+    [P7R_MESSAGE_REAL_TYPE(P7R_MESSAGE_STEAL_RESPONSE)] = u2cc_handler_steal_response,
+    [P7R_MESSAGE_REAL_TYPE(P7R_MESSAGE_WAKEUP)] = u2cc_handler_wakeup,
+};
+
+// bus backends - epoll, or io_uring where the kernel has it
+
+static
+int ring_slots_grow(struct p7r_scheduler *scheduler) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    uint32_t n_slots = scheduler->bus.n_ring_slots ? (scheduler->bus.n_ring_slots * 2) : 64;
+    struct p7r_bus_ring_slot *slots = scraft_allocate(allocator, sizeof(struct p7r_bus_ring_slot) * n_slots);
+    if (unlikely(slots == NULL))
+        return -1;
+    if (scheduler->bus.ring_slots) {
+        memcpy(slots, scheduler->bus.ring_slots, sizeof(struct p7r_bus_ring_slot) * scheduler->bus.n_ring_slots);
+        scraft_deallocate(allocator, scheduler->bus.ring_slots);
+    }
+    // slot 0 stays with the notification for good
+    uint32_t first_new = scheduler->bus.n_ring_slots ? scheduler->bus.n_ring_slots : 1;
+    for (uint32_t index = n_slots - 1; index >= first_new; index--)
+        (slots[index].delegation = NULL), (slots[index].remove_owed = P7R_BUS_RING_REMOVE_NONE),
+            (slots[index].next_free = scheduler->bus.ring_slot_free), (scheduler->bus.ring_slot_free = index);
+    (scheduler->bus.ring_slots = slots), (scheduler->bus.n_ring_slots = n_slots);
+    return 0;
+}
+
+static inline
+uint32_t ring_slot_acquire(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
+    if (unlikely(scheduler->bus.ring_slot_free == P7R_BUS_RING_NO_SLOT) && (ring_slots_grow(scheduler) == -1))
+        return P7R_BUS_RING_NO_SLOT;
+    uint32_t index = scheduler->bus.ring_slot_free;
+    (scheduler->bus.ring_slot_free = scheduler->bus.ring_slots[index].next_free), (scheduler->bus.ring_slots[index].delegation = delegation);
+    return index;
+}
+
+static inline
+struct p7r_delegation *ring_slot_release(struct p7r_scheduler *scheduler, uint32_t index) {
+    struct p7r_delegation *delegation = scheduler->bus.ring_slots[index].delegation;
+    // still chained for its POLL_REMOVE - the owed list gives it back once it gets there
+    if (unlikely(scheduler->bus.ring_slots[index].remove_owed != P7R_BUS_RING_REMOVE_NONE))
+        return (scheduler->bus.ring_slots[index].remove_owed = P7R_BUS_RING_REMOVE_MOOT), delegation;
+    (scheduler->bus.ring_slots[index].next_free = scheduler->bus.ring_slot_free), (scheduler->bus.ring_slot_free = index);
+    return delegation;
+}
+
+static inline
+uint32_t ring_poll_mask_of(struct p7r_delegation *delegation) {
+    return ((delegation->p7r_event & P7R_DELEGATION_READ) ? POLLIN : 0) | ((delegation->p7r_event & P7R_DELEGATION_WRITE) ? POLLOUT : 0);
+}
+
+static
+int bus_epoll_wait(struct p7r_scheduler *scheduler, int timeout) {
+    return epoll_wait(scheduler->bus.fd_epoll, scheduler->bus.epoll_events, scheduler->bus.n_epoll_events, timeout);
+}
+
+static
+int bus_epoll_io_arm(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
+    int fd = delegation->checked_events.io.fd, fd_epoll = scheduler->bus.fd_epoll;
+    delegation->checked_events.io.epoll_event.events = ring_poll_mask_of(delegation) | EPOLLONESHOT;
+    delegation->checked_events.io.epoll_event.data.ptr = delegation;
+    if (epoll_ctl(fd_epoll, EPOLL_CTL_MOD, fd, &(delegation->checked_events.io.epoll_event)) == -1)
+        if ((errno != ENOENT) || (epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd, &(delegation->checked_events.io.epoll_event)) == -1))
+            return 0;
+    return 1;
+}
+
+static
+void bus_epoll_io_disarm(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
+    // still armed and pointing into a frame which is about to go away
+    epoll_ctl(scheduler->bus.fd_epoll, EPOLL_CTL_DEL, delegation->checked_events.io.fd, NULL);
+}
+
+static
+void bus_epoll_notification_rearm(struct p7r_scheduler *scheduler) {
+    // level-triggered and never oneshot - nothing to do
+}
+
+static
+int bus_epoll_fd_register(struct p7r_scheduler *scheduler, struct p7r_fd *handle) {
+    struct epoll_event *event = &(handle->registration.checked_events.io.epoll_event);
+    (event->events = EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET), (event->data.ptr = &(handle->registration));
+    return handle->registration.checked_events.io.enabled = (epoll_ctl(scheduler->bus.fd_epoll, EPOLL_CTL_ADD, handle->fd, event) == 0);
+}
+
+static
+void bus_epoll_fd_unregister(struct p7r_scheduler *scheduler, struct p7r_fd *handle) {
+    epoll_ctl(scheduler->bus.fd_epoll, EPOLL_CTL_DEL, handle->fd, NULL);
+}
+
+static
+int bus_uring_remove_submit(struct p7r_scheduler *scheduler, uint32_t slot) {
+    struct io_uring_sqe *sqe = p7r_uring_sqe(&(scheduler->bus.ring));
+    if (unlikely(sqe == NULL))
+        return 0;
+    (sqe->opcode = IORING_OP_POLL_REMOVE), (sqe->fd = -1), (sqe->addr = slot), (sqe->user_data = P7R_BUS_RING_UNTRACKED);
+    return 1;
+}
+
+static
+int bus_uring_notification_submit(struct p7r_scheduler *scheduler) {
+    struct io_uring_sqe *sqe = p7r_uring_sqe(&(scheduler->bus.ring));
+    if (unlikely(sqe == NULL))
+        return 0;
+    (sqe->opcode = IORING_OP_POLL_ADD), (sqe->fd = scheduler->bus.fd_notification),
+        (sqe->poll32_events = POLLIN), (sqe->user_data = P7R_BUS_RING_NOTIFICATION);
+    return 1;
+}
+
+static
+void bus_uring_owed_submit(struct p7r_scheduler *scheduler) {
+    scheduler->bus.ring_notification_owed && bus_uring_notification_submit(scheduler) && (scheduler->bus.ring_notification_owed = 0);
+    uint32_t slot;
+    while ((slot = scheduler->bus.ring_removes_owed) != P7R_BUS_RING_NO_SLOT) {
+        struct p7r_bus_ring_slot *owed = &(scheduler->bus.ring_slots[slot]);
+        int moot = (owed->remove_owed == P7R_BUS_RING_REMOVE_MOOT);
+        if (!moot && !bus_uring_remove_submit(scheduler, slot))
+            break;
+        (scheduler->bus.ring_removes_owed = owed->next_owed), (owed->remove_owed = P7R_BUS_RING_REMOVE_NONE);
+        // its last completion has already come and gone - nobody else is going to free it
+        moot && ring_slot_release(scheduler, slot);
+    }
+}
+
+static
+int bus_uring_wait(struct p7r_scheduler *scheduler, int timeout) {
+    bus_uring_owed_submit(scheduler);
+    // without the eventfd poll no knock reaches us, so do not sleep for long before trying again
+    scheduler->bus.ring_notification_owed && ((timeout < 0) || (timeout > 1)) && (timeout = 1);
+    if (p7r_uring_enter(&(scheduler->bus.ring), (timeout < 0) ? -1 : ((int64_t) timeout * 1000 * 1000)) == -1)
+        return -1;
+    int n_events = 0;
+    struct io_uring_cqe *cqe;
+    // whatever does not fit stays in the completion queue for the next refresh
+    while ((n_events < scheduler->bus.n_epoll_events) && ((cqe = p7r_uring_cqe_peek(&(scheduler->bus.ring))) != NULL)) {
+        uint64_t user_data = cqe->user_data;
+        int32_t result = cqe->res;
+        int more = cqe->flags & IORING_CQE_F_MORE;
+        p7r_uring_cqe_seen(&(scheduler->bus.ring));
+        if (user_data == P7R_BUS_RING_UNTRACKED)
+            continue;
+        // a multishot poll keeps its slot until its last completion
+        struct p7r_delegation *delegation = (user_data == P7R_BUS_RING_NOTIFICATION) ? &(scheduler->bus.notification) :
+            (more ? scheduler->bus.ring_slots[user_data].delegation : ring_slot_release(scheduler, (uint32_t) user_data));
+        if (delegation == NULL)
+            continue;
+        ((delegation->p7r_event & P7R_DELEGATION_PERSISTENT) && !more) && (delegation->checked_events.io.enabled = 0);
+        delegation->checked_events.io.result = result;
+        // events only mean something for polls - ring operations are judged by io.result
+        scheduler->bus.epoll_events[n_events].events = (result < 0) ? EPOLLERR : (uint32_t) result;
+        scheduler->bus.epoll_events[n_events++].data.ptr = delegation;
+    }
+    return n_events;
+}
+
+static
+struct io_uring_sqe *bus_uring_sqe_for(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation, uint8_t opcode, int fd) {
+    uint32_t slot = ring_slot_acquire(scheduler, delegation);
+    if (unlikely(slot == P7R_BUS_RING_NO_SLOT))
+        return NULL;
+    struct io_uring_sqe *sqe = p7r_uring_sqe(&(scheduler->bus.ring));
+    if (unlikely(sqe == NULL))
+        return ring_slot_release(scheduler, slot), NULL;
+    (sqe->opcode = opcode), (sqe->fd = fd), (sqe->user_data = slot);
+    delegation->checked_events.io.ring_slot = slot;
+    return sqe;
+}
+
+static
+int bus_uring_io_arm(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
+    struct io_uring_sqe *sqe = bus_uring_sqe_for(scheduler, delegation, IORING_OP_POLL_ADD, delegation->checked_events.io.fd);
+    if (unlikely(sqe == NULL))
+        return 0;
+    sqe->poll32_events = ring_poll_mask_of(delegation);
+    return 1;
+}
+
+static
+void bus_uring_io_disarm(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
+    uint32_t slot = delegation->checked_events.io.ring_slot;
+    scheduler->bus.ring_slots[slot].delegation = NULL;
+    // a multishot poll would pin its fd and its slot for good - whatever the full ring turns away is owed until the next refresh
+    if (unlikely(!bus_uring_remove_submit(scheduler, slot)))
+        (scheduler->bus.ring_slots[slot].remove_owed = P7R_BUS_RING_REMOVE_OWED),
+            (scheduler->bus.ring_slots[slot].next_owed = scheduler->bus.ring_removes_owed), (scheduler->bus.ring_removes_owed = slot);
+}
+
+static
+void bus_uring_notification_rearm(struct p7r_scheduler *scheduler) {
+    scheduler->bus.ring_notification_owed = !bus_uring_notification_submit(scheduler);
+}
+
+static
+int bus_uring_fd_register(struct p7r_scheduler *scheduler, struct p7r_fd *handle) {
+    struct io_uring_sqe *sqe = bus_uring_sqe_for(scheduler, &(handle->registration), IORING_OP_POLL_ADD, handle->fd);
+    if (unlikely(sqe == NULL))
+        return 0;
+    // multishot polls report wakeups, not levels - edge-triggered like the epoll flavour
+    (sqe->len = IORING_POLL_ADD_MULTI), (sqe->poll32_events = POLLIN|POLLOUT|POLLRDHUP);
+    return handle->registration.checked_events.io.enabled = 1;
+}
+
+static
+void bus_uring_fd_unregister(struct p7r_scheduler *scheduler, struct p7r_fd *handle) {
+    if (handle->registration.checked_events.io.enabled)
+        bus_uring_io_disarm(scheduler, &(handle->registration));
+}
+
+static
+struct {
+    int (*wait)(struct p7r_scheduler *, int);
+    int (*io_arm)(struct p7r_scheduler *, struct p7r_delegation *);
+    void (*io_disarm)(struct p7r_scheduler *, struct p7r_delegation *);
+    void (*notification_rearm)(struct p7r_scheduler *);
+    int (*fd_register)(struct p7r_scheduler *, struct p7r_fd *);
+    void (*fd_unregister)(struct p7r_scheduler *, struct p7r_fd *);
+} p7r_bus_backends[P7R_N_BUS_BACKENDS] = {
+    [P7R_BUS_BACKEND_EPOLL] = {
+        bus_epoll_wait, bus_epoll_io_arm, bus_epoll_io_disarm, bus_epoll_notification_rearm, bus_epoll_fd_register, bus_epoll_fd_unregister
+    },
+    [P7R_BUS_BACKEND_URING] = {
+        bus_uring_wait, bus_uring_io_arm, bus_uring_io_disarm, bus_uring_notification_rearm, bus_uring_fd_register, bus_uring_fd_unregister
+    },
 };
 
+#define     sched_bus_backend(scheduler_)   (&(p7r_bus_backends[(scheduler_)->bus.backend]))
+
+static inline
+void sched_delegation_fire(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
+    delegation->checked_events.io.triggered = 1;
+    // remove triggered timer event
+    if (!delegation->checked_events.timer.measurement.triggered) {
+        p7r_uthread_reenable(scheduler, delegation->uthread);
+        if (delegation->checked_events.timer.enabled)
+            p7r_timer_core_detach(&(delegation->checked_events.timer.measurement));
+    }
+}
+
+static
+void sched_delegation_wake(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
+    delegation->checked_events.oob.triggered = 1;
+    // unlike i/o, a wake is owed even after the timer - the waiter may be parked again just to collect it
+    p7r_uthread_reenable(scheduler, delegation->uthread);
+    if (delegation->checked_events.timer.enabled && !delegation->checked_events.timer.measurement.triggered)
+        p7r_timer_core_detach(&(delegation->checked_events.timer.measurement));
+}
+
+// a waiter for both directions sits in both queues
+static inline
+void sched_fd_waiter_leave(struct p7r_fd_waiter *waiter) {
+    for (int direction = P7R_FD_WAITER_READ; direction <= P7R_FD_WAITER_WRITE; direction++)
+        list_node_isolated(&(waiter->linkable[direction])) || (list_del(&(waiter->linkable[direction])), 0);
+}
+
+static
+void sched_fd_edge(struct p7r_scheduler *scheduler, struct p7r_fd *handle, uint32_t events) {
+    (events & (EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR)) && (handle->ready |= P7R_DELEGATION_READ);
+    (events & (EPOLLOUT|EPOLLHUP|EPOLLERR)) && (handle->ready |= P7R_DELEGATION_WRITE);
+    // every waiter of a direction which got ready, in arrival order - the first to run take what the edge brought,
+    // the rest hear EAGAIN and queue up again
+    for (int direction = P7R_FD_WAITER_READ; direction <= P7R_FD_WAITER_WRITE; direction++) {
+        list_ctl_t *waiters = &(handle->waiters[direction]);
+        while ((handle->ready & (P7R_DELEGATION_READ << direction)) && !list_is_empty(waiters)) {
+            struct p7r_fd_waiter *waiter = container_of(waiters->next, struct p7r_fd_waiter, linkable[direction]);
+            sched_fd_waiter_leave(waiter);
+            sched_delegation_fire(scheduler, waiter->delegation);
+        }
+    }
+    // the ring ended our multishot poll - ask again
+    if (!handle->registration.checked_events.io.enabled)
+        sched_bus_backend(scheduler)->fd_register(scheduler, handle);
+}
+
+static
+void sched_gauges_update(struct p7r_scheduler *scheduler) {
+    struct p7r_carrier_counters *counters = scheduler->counters;
+    scheduler->n_refreshes = 0;
+    __atomic_store_n(&(counters->n_runnable), scheduler->load.n_runnable, __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->n_requests), scheduler->load.n_requests, __ATOMIC_RELAXED);
+    for (uint32_t zone = 0; zone < P7R_COUNTERS_N_STACK_ZONES; zone++) {
+        struct p7r_stack_zone_stat stat = p7r_stack_allocator_stat(&(scheduler->runners.stack_allocator), zone);
+        __atomic_store_n(&(counters->stack_bytes_reserved[zone]), stat.n_bytes_reserved, __ATOMIC_RELAXED);
+        __atomic_store_n(&(counters->stack_bytes_committed[zone]), stat.n_bytes_committed, __ATOMIC_RELAXED);
+        __atomic_store_n(&(counters->stack_bytes_resident[zone]), stat.n_bytes_resident, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&(counters->n_slaves), p7r_stack_allocator_n_slaves(&(scheduler->runners.stack_allocator)), __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->parked), __atomic_load_n(&(scheduler->elastic.parked), __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&(counters->updated_at), get_timestamp_ns_monotonic(), __ATOMIC_RELAXED);
+}
+
+// elastic carriers - parked by themselves after a whole wait in vain, unparked by busy peers
+
+static
+void sched_park(struct p7r_scheduler *scheduler) {
+    // peers parking at the same time settle it by the count
+    uint32_t n_parked = __atomic_add_fetch(&(elastic.n_parked), 1, __ATOMIC_ACQ_REL);
+    if (p7r_n_carriers() - n_parked < elastic.min_unparked) {
+        __atomic_sub_fetch(&(elastic.n_parked), 1, __ATOMIC_ACQ_REL);
+        return;
+    }
+    __atomic_store_n(&(scheduler->elastic.parked), 1, __ATOMIC_RELEASE);
+    sched_count(scheduler, n_parks);
+    // no uthreads to come for a while - nor for the memory of their stacks
+    p7r_stack_allocator_trim(&(scheduler->runners.stack_allocator));
+}
+
+static
+void sched_unpark_on_demand(struct p7r_scheduler *scheduler) {
+    if (likely(__atomic_load_n(&(elastic.n_parked), __ATOMIC_RELAXED) == 0))
+        return;
+    uint32_t n = p7r_n_carriers(), n_unparked = 0, depth = 0, candidate = UINT32_MAX;
+    for (uint32_t index = 0; index < n; index++) {
+        if (__atomic_load_n(&(schedulers[index].elastic.parked), __ATOMIC_RELAXED)) {
+            (candidate == UINT32_MAX) && (candidate = index);
+            continue;
+        }
+        (n_unparked++), (depth += sched_queue_depth(&(schedulers[index])));
+    }
+    if ((candidate == UINT32_MAX) || (depth <= elastic.unpark_depth * n_unparked))
+        return;
+    // busy peers may see the same - one of them gets to do it
+    uint32_t expected = 1;
+    if (__atomic_compare_exchange_n(&(schedulers[candidate].elastic.parked), &expected, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        __atomic_sub_fetch(&(elastic.n_parked), 1, __ATOMIC_ACQ_REL);
+        // back to stealing at once, and to a fresh count of idleness
+        p7r_u2cc_knock(&(schedulers[candidate]));
+    }
+}
+
+// Polls the inbox and the bus instead of sleeping, for a window at most and no longer than the next timer. Returns
+// the events found on the bus; *timeout drops to 0 once there is anything to do, or by the time spent otherwise.
+static
+int sched_bus_spin(struct p7r_scheduler *scheduler, int *timeout) {
+    uint64_t spin_begin = get_timestamp_ns_monotonic(), now = spin_begin;
+    uint64_t deadline = spin_begin + scheduler->policy.busy_poll.window_ns;
+    int timer_cut = (*timeout > 0) && (spin_begin + (uint64_t) *timeout * 1000000 <= deadline);
+    timer_cut && (deadline = spin_begin + (uint64_t) *timeout * 1000000);
+    int n_active_fds = 0, found = 0;
+    for (uint32_t round = 1; !found && (now < deadline); round++) {
+        found = !p7r_inbox_is_empty(&(scheduler->bus.inbox)) ||
+            (((round % P7R_BUSY_POLL_BUS_EVERY) == 0) && (sched_count(scheduler, n_bus_waits), 1) &&
+                ((n_active_fds = sched_bus_backend(scheduler)->wait(scheduler, 0)) != 0));
+        found || (__builtin_ia32_pause(), now = get_timestamp_ns_monotonic());
+    }
+    sched_idleness_account(scheduler, now - spin_begin, now);
+    if (found || timer_cut)
+        return *timeout = 0, n_active_fds;
+    // in vain
+    scheduler->policy.busy_poll.adaptive && (scheduler->policy.busy_poll.window_ns >>= 1);
+    (*timeout > 0) && (*timeout -= (now - spin_begin) / 1000000);
+    return 0;
+}
+
 static
 int sched_bus_refresh(struct p7r_scheduler *scheduler) {
     // Phase 1 - adjust timeout baseline
@@ -241,11 +915,58 @@ int sched_bus_refresh(struct p7r_scheduler *scheduler) {
         ((timer_earliest) && (timeout < 1)) && (timeout = 0);
     }
 
-    (!list_is_empty(&(scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING]))) && (timeout = 0);
+    sched_runnable_any(scheduler) && (timeout = 0);
+    // requests not picked yet are work too - a parking uthread must not put them to sleep with it
+    sched_requests_any(scheduler) && (timeout = 0);
+
+    // nothing to run and about to sleep - ask a busy peer for work, its answer wakes us up
+    int parked = scheduler->elastic.parked;
+    if (timeout && scheduler->policy.stealing.enabled && !sched_requests_any(scheduler) && !parked)
+        sched_steal(scheduler);
+
+    // a bit of CPU for a wake without the eventfd and the futex behind it
+    int n_active_fds = 0;
+    (timeout && scheduler->policy.busy_poll.window_ns && !parked) && (n_active_fds = sched_bus_spin(scheduler, &timeout));
+
+    if (((++scheduler->n_refreshes) >= P7R_COUNTERS_GAUGE_PERIOD) || timeout) {
+        sched_gauges_update(scheduler);
+        // only a carrier with work of its own looks out for more hands
+        timeout || (sched_unpark_on_demand(scheduler), 0);
+    }
+
+    // a wait which runs its full course is idleness of park_after_ms - it ends in a park
+    uint32_t park_after_ms = scheduler->elastic.park_after_ms;
+    int park_due = timeout && (n_active_fds == 0) && park_after_ms && !parked && ((timeout < 0) || ((uint32_t) timeout >= park_after_ms));
+    park_due && (timeout = park_after_ms);
+
+    // advertise the park before the last look at the inbox - pairs with the fence in p7r_u2cc_message_post
+    if (timeout) {
+        // partial batches of freed blocks go home before we sleep on them
+        p7r_message_slab_flush(&(scheduler->bus.slab));
+        __atomic_store_n(&(scheduler->bus.parked), P7R_BUS_PARKED, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        (!p7r_inbox_is_empty(&(scheduler->bus.inbox))) && (timeout = 0);
+    }
 
-    int n_active_fds = epoll_wait(scheduler->bus.fd_epoll, scheduler->bus.epoll_events, scheduler->bus.n_epoll_events, timeout);
+    uint64_t wait_begin = timeout ? get_timestamp_ns_monotonic() : 0, traced_at = scheduler->trace ? __builtin_ia32_rdtsc() : 0;
+    (n_active_fds == 0) && (sched_count(scheduler, n_bus_waits), n_active_fds = sched_bus_backend(scheduler)->wait(scheduler, timeout));
+    sched_trace(scheduler, P7R_TRACE_BUS, n_active_fds, __builtin_ia32_rdtsc() - traced_at, (uint32_t) timeout);
+    if (timeout) {
+        uint64_t wait_end = get_timestamp_ns_monotonic();
+        sched_idleness_account(scheduler, wait_end - wait_begin, wait_end);
+        sched_count(scheduler, n_bus_sleeps), sched_count_add(scheduler, slept_ns, wait_end - wait_begin);
+        // a spin would have caught this one
+        (scheduler->policy.busy_poll.adaptive && (wait_end - wait_begin < scheduler->policy.busy_poll.max_ns)) &&
+            (scheduler->policy.busy_poll.window_ns = scheduler->policy.busy_poll.max_ns);
+    } else if ((++scheduler->load.n_busy_refreshes) >= P7R_LOAD_BUSY_REFRESHES) {
+        // a carrier which never sleeps has to close its windows too, or placement keeps seeing the last idle one
+        scheduler->load.n_busy_refreshes = 0;
+        sched_idleness_account(scheduler, 0, get_timestamp_ns_monotonic());
+    }
+    __atomic_store_n(&(scheduler->bus.parked), P7R_BUS_BUSY, __ATOMIC_RELAXED);
     if (n_active_fds < 0)
         return -1;
+    (park_due && (n_active_fds == 0) && p7r_inbox_is_empty(&(scheduler->bus.inbox))) && (sched_park(scheduler), 0);
     scheduler->bus.consumed = 1;        // XXX consumer flag must be reset here
 
     // Phase 2 - timeout handling
@@ -264,39 +985,32 @@ int sched_bus_refresh(struct p7r_scheduler *scheduler) {
     for (int event_index = 0; event_index < n_active_fds; event_index++) {
         struct p7r_delegation *delegation = scheduler->bus.epoll_events[event_index].data.ptr;
         if (delegation == &(scheduler->bus.notification)) {
+            // at most one write per park, so one read drains the counter
             uint64_t notification_counter;
             read(scheduler->bus.fd_notification, &notification_counter, sizeof(uint64_t));
-        } else {
-            delegation->checked_events.io.triggered = 1;
-            // remove triggered timer event
-            if (!delegation->checked_events.timer.triggered) {
-                p7r_uthread_reenable(scheduler, delegation->uthread);
-                scraft_rbt_detach(&(delegation->checked_events.timer.measurement.maplink));
-            }
-        }
+            sched_bus_backend(scheduler)->notification_rearm(scheduler);
+        } else if (delegation->p7r_event & P7R_DELEGATION_PERSISTENT) {
+            sched_fd_edge(scheduler, container_of(delegation, struct p7r_fd, registration), scheduler->bus.epoll_events[event_index].events);
+        } else
+            sched_delegation_fire(scheduler, delegation);
     }
 
     // Phase 4 - iuc/u2cc handling
-    for (uint32_t carrier_index = 0; carrier_index < scheduler->n_carriers; carrier_index++) {
-        list_ctl_t *target_queue;
-        uint32_t n_retry_times = CP_BUFFER_RETRY_TIMES;
-        do {
-            target_queue = cp_buffer_consume(&(scheduler->bus.message_boxes[carrier_index]));
-        } while (!target_queue && --n_retry_times);
-        scheduler->bus.consumed &= scheduler->bus.message_boxes[carrier_index].consuming;
-        if (target_queue) {
-            list_ctl_t *p, *t;
-            list_foreach_remove(p, target_queue, t) {
-                list_del(t);
-                struct p7r_internal_message *message = container_of(t, struct p7r_internal_message, linkable);
-                p7r_internal_handlers[P7R_MESSAGE_REAL_TYPE(message->type)](scheduler, message);    // XXX highly dangerous
-            }
+    {
+        list_ctl_t messages, *p, *t;
+        init_list_head(&messages);
+        p7r_inbox_drain(&(scheduler->bus.inbox), &messages);
+        list_foreach_remove(p, &messages, t) {
+            list_del(t);
+            struct p7r_internal_message *message = container_of(t, struct p7r_internal_message, linkable);
+            sched_count(scheduler, n_messages_received);
+            sched_trace(scheduler, P7R_TRACE_RECEIVE, message->from, P7R_MESSAGE_REAL_TYPE(message->type), 0);
+            p7r_internal_handlers[P7R_MESSAGE_REAL_TYPE(message->type)](scheduler, message);    // XXX highly dangerous
         }
     }
 
     // Phase 5 - iuc discarding
     // TODO implementation
-
     // Phase 6 - R.I.P. those who chose not to reincarnate
     {
         list_ctl_t *p, *t;
@@ -304,6 +1018,7 @@ int sched_bus_refresh(struct p7r_scheduler *scheduler) {
             list_del(t);
             struct p7r_uthread *uthread_dying = container_of(t, struct p7r_uthread, linkable);
             p7r_uthread_delete(uthread_dying);
+            sched_count(scheduler, n_reaped);
         }
     }
 
@@ -311,12 +1026,12 @@ int sched_bus_refresh(struct p7r_scheduler *scheduler) {
 }
 
 static
-struct p7r_uthread_request sched_cherry_pick(struct p7r_scheduler *scheduler) {
+struct p7r_uthread_request sched_cherry_pick_of(struct p7r_scheduler *scheduler, uint32_t priority) {
     struct p7r_uthread_request request = { .user_entrance = NULL, .user_argument = NULL };
-    if (!list_is_empty(&(scheduler->runners.request_queue))) {
-        list_ctl_t *target_link = scheduler->runners.request_queue.next;
-        list_del(target_link);
+    if (!list_is_empty(&(scheduler->runners.request_queues[priority]))) {
+        list_ctl_t *target_link = scheduler->runners.request_queues[priority].next;
         struct p7r_uthread_request *target_request = container_of(target_link, struct p7r_uthread_request, linkable);
+        sched_request_dequeue(scheduler, target_request);
         request = *target_request;
         struct p7r_internal_message *message = P7R_MESSAGE_OF(target_request);  // XXX u2cc message deletion
         p7r_internal_message_delete(message);
@@ -324,6 +1039,15 @@ struct p7r_uthread_request sched_cherry_pick(struct p7r_scheduler *scheduler) {
     return request;
 }
 
+// the most urgent request pending
+static
+struct p7r_uthread_request sched_cherry_pick(struct p7r_scheduler *scheduler) {
+    for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++)
+        if (!list_is_empty(&(scheduler->runners.request_queues[priority])))
+            return sched_cherry_pick_of(scheduler, priority);
+    return (struct p7r_uthread_request) { .user_entrance = NULL, .user_argument = NULL };
+}
+
 static
 struct p7r_uthread *sched_uthread_from_request(
         struct p7r_scheduler *scheduler, 
@@ -335,13 +1059,19 @@ struct p7r_uthread *sched_uthread_from_request(
                 request.user_entrance, 
                 request.user_argument, 
                 &(scheduler->runners.stack_allocator),
-                stack_alloc_policy);
-    uthread->future = request.future;
+                request.stack_class,
+                stack_alloc_policy,
+                sched_stack_hint_of(scheduler, request.user_entrance));
     if (unlikely(uthread == NULL)) {
         if (request.user_argument_dtor)
             request.user_argument_dtor(request.user_argument);
         return NULL;
     }
+    (uthread->future = request.future), (uthread->entrance.user_argument_dtor = request.user_argument_dtor);
+    uthread->priority = request.priority;
+    sched_fresh_adjust(scheduler, 1);
+    sched_count(scheduler, n_spawned);
+    sched_trace(scheduler, P7R_TRACE_CREATE, uthread, request.user_entrance, uthread->priority);
     return uthread;
 
 }
@@ -363,25 +1093,59 @@ void swarm_sched_refill(struct p7r_scheduler *scheduler) {
     (scheduler->runners.tokens < scheduler->policy.swarm.max_tokens) && (scheduler->runners.tokens++);
 }
 
+// A priority has work when it has runnable uthreads or pending requests. The most urgent one with credits left in this
+// round goes next, or the most urgent one at all when a new round is due - P7R_N_PRIORITIES if there is no work.
+static inline
+uint32_t sched_dispatch_peek(struct p7r_scheduler *scheduler) {
+    uint32_t first = P7R_N_PRIORITIES;
+    for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++) {
+        if (list_is_empty(&(scheduler->runners.sched_queues[P7R_SCHED_RUN_QUEUE(priority)])) &&
+                list_is_empty(&(scheduler->runners.request_queues[priority])))
+            continue;
+        if (scheduler->policy.dispatch.strict || scheduler->runners.credits[priority])
+            return priority;
+        (first == P7R_N_PRIORITIES) && (first = priority);
+    }
+    return first;
+}
+
+static inline
+uint32_t sched_dispatch(struct p7r_scheduler *scheduler) {
+    uint32_t priority = sched_dispatch_peek(scheduler);
+    if ((priority == P7R_N_PRIORITIES) || scheduler->policy.dispatch.strict)
+        return priority;
+    // everyone with work is out of credits
+    (scheduler->runners.credits[priority] == 0) &&
+        (memcpy(scheduler->runners.credits, scheduler->policy.dispatch.weights, sizeof(uint32_t) * P7R_N_PRIORITIES), 0);
+    scheduler->runners.credits[priority]--;
+    return priority;
+}
+
 static
 struct p7r_uthread *sched_resched_target(struct p7r_scheduler *scheduler) {
     if (scheduler->runners.running != NULL) {
         struct p7r_uthread *last_target = scheduler->runners.running;
         list_del(&(last_target->linkable));
-        list_add_tail(&(last_target->linkable), &(scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING]));
+        list_add_tail(&(last_target->linkable), &(scheduler->runners.sched_queues[P7R_SCHED_RUN_QUEUE(last_target->priority)]));
     }
-    // XXX it depends
-    if (swarm_sched_available(scheduler) || list_is_empty(&(scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING]))) {
-        struct p7r_uthread_request request = sched_cherry_pick(scheduler);
-        if (p7r_uthread_request_is_null(request))
+    for (;;) {
+        uint32_t priority = sched_dispatch(scheduler);
+        if (priority == P7R_N_PRIORITIES)
             return NULL;
-        struct p7r_uthread *uthread = sched_uthread_from_request(scheduler, request, P7R_STACK_POLICY_DEFAULT);
-        if (!uthread && request.user_argument_dtor)
-            request.user_argument_dtor(request.user_argument);
-        list_add_tail(&(uthread->linkable), &(scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING]));
+        list_ctl_t *run_queue = &(scheduler->runners.sched_queues[P7R_SCHED_RUN_QUEUE(priority)]);
+        // XXX it depends
+        if (swarm_sched_available(scheduler) || list_is_empty(run_queue)) {
+            struct p7r_uthread_request request = sched_cherry_pick_of(scheduler, priority);
+            if (!p7r_uthread_request_is_null(request)) {
+                struct p7r_uthread *uthread = sched_uthread_from_request(scheduler, request, P7R_STACK_POLICY_DEFAULT);
+                if (uthread)
+                    sched_runnable_enqueue(scheduler, uthread);
+            }
+        }
+        if (!list_is_empty(run_queue))
+            return scheduler->runners.running = container_of(run_queue->next, struct p7r_uthread, linkable);
+        // the request got no stack and is gone - look again
     }
-    list_ctl_t *target_reference = scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING].next;
-    return scheduler->runners.running = container_of(target_reference, struct p7r_uthread, linkable);
 }
 
 static
@@ -389,6 +1153,42 @@ void sched_idle(struct p7r_uthread *uthread) {
     p7r_context_switch(schedulers[uthread->scheduler_index].runners.carrier_context, &(uthread->context));
 }
 
+static inline
+uint32_t sched_stealable_load(struct p7r_scheduler *scheduler) {
+    return sched_load_peek(&(scheduler->load.n_requests)) + sched_load_peek(&(scheduler->load.n_fresh));
+}
+
+static
+struct p7r_scheduler *sched_steal_victim(struct p7r_scheduler *scheduler) {
+    struct p7r_scheduler *victim = NULL;
+    uint32_t victim_load = scheduler->policy.stealing.threshold;
+    uint32_t start_index = scheduler->bus.steal_cursor++;
+    for (uint32_t offset = 0; offset < scheduler->n_carriers; offset++) {
+        struct p7r_scheduler *peer = &(schedulers[(start_index + offset) % scheduler->n_carriers]);
+        if (peer == scheduler)
+            continue;
+        uint32_t peer_load = sched_stealable_load(peer);
+        if (peer_load >= victim_load)
+            (victim = peer), (victim_load = peer_load + 1);
+    }
+    return victim;
+}
+
+static
+void sched_steal(struct p7r_scheduler *scheduler) {
+    // one request in flight at most - the response is the only thing that clears the flag
+    if (scheduler->bus.stealing)
+        return;
+    struct p7r_scheduler *victim = sched_steal_victim(scheduler);
+    if (victim == NULL)
+        return;
+    struct p7r_internal_message *message = p7r_u2cc_message_raw(P7R_MESSAGE_STEAL_REQUEST, 0);
+    if (unlikely(message == NULL))
+        return;
+    scheduler->bus.stealing = 1;
+    p7r_u2cc_message_post(victim->index, scheduler->index, message);
+}
+
 static
 struct p7r_scheduler *p7r_scheduler_init(
         struct p7r_scheduler *scheduler, 
@@ -396,7 +1196,9 @@ struct p7r_scheduler *p7r_scheduler_init(
         uint32_t n_carriers, 
         struct p7r_context *carrier_context,
         struct p7r_stack_allocator_config config,
-        int event_buffer_capacity) {
+        int event_buffer_capacity,
+        uint32_t backend,
+        uint32_t ring_entries) {
     __atomic_store_n(&(scheduler->status), P7R_SCHEDULER_BORN, __ATOMIC_RELEASE);
     __auto_type allocator = p7r_root_alloc_get_proxy();
 
@@ -406,12 +1208,26 @@ struct p7r_scheduler *p7r_scheduler_init(
 
     for (uint32_t queue_index = 0; queue_index < sizeof(scheduler->runners.sched_queues) / sizeof(list_ctl_t); queue_index++)
         init_list_head(&(scheduler->runners.sched_queues[queue_index]));
-    init_list_head(&(scheduler->runners.request_queue));
-    scheduler->runners.running = NULL;
+    for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++)
+        (init_list_head(&(scheduler->runners.request_queues[priority]))), (scheduler->runners.credits[priority] = 0);
+    (scheduler->runners.running = NULL), (scheduler->runners.tokens = 0);
+    (scheduler->load.n_runnable = 0), (scheduler->load.n_requests = 0), (scheduler->load.n_fresh = 0);
+    (scheduler->load.idle_permille = 0), (scheduler->load.window_start = get_timestamp_ns_monotonic()), (scheduler->load.idle_ns = 0);
+    scheduler->load.n_busy_refreshes = 0;
 
-    scheduler->bus.fd_epoll = epoll_create1(EPOLL_CLOEXEC);
     scheduler->bus.fd_notification = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
-    {
+    (scheduler->bus.ring_slots = NULL), (scheduler->bus.n_ring_slots = 0), (scheduler->bus.ring_slot_free = P7R_BUS_RING_NO_SLOT);
+    (scheduler->bus.ring_removes_owed = P7R_BUS_RING_NO_SLOT), (scheduler->bus.ring_notification_owed = 0);
+    scheduler->bus.backend = P7R_BUS_BACKEND_EPOLL;
+    if ((backend == P7R_BUS_BACKEND_URING) && p7r_uring_init(&(scheduler->bus.ring), ring_entries)) {
+        if (ring_slots_grow(scheduler) == 0) {
+            scheduler->bus.backend = P7R_BUS_BACKEND_URING;
+            bus_uring_notification_rearm(scheduler);
+        } else
+            p7r_uring_ruin(&(scheduler->bus.ring));
+    }
+    scheduler->bus.fd_epoll = (scheduler->bus.backend == P7R_BUS_BACKEND_EPOLL) ? epoll_create1(EPOLL_CLOEXEC) : -1;
+    if (scheduler->bus.backend == P7R_BUS_BACKEND_EPOLL) {
         scheduler->bus.notification.checked_events.io.fd = scheduler->bus.fd_notification;
         scheduler->bus.notification.checked_events.io.epoll_event.events = EPOLLIN;
         scheduler->bus.notification.checked_events.io.epoll_event.data.ptr = &(scheduler->bus.notification);
@@ -422,10 +1238,21 @@ struct p7r_scheduler *p7r_scheduler_init(
                 &(scheduler->bus.notification.checked_events.io.epoll_event));
     }
     scheduler->bus.consumed = 1;
-    scheduler->bus.message_boxes = scraft_allocate(allocator, sizeof(struct p7r_cpbuffer) * n_carriers);
-    for (uint32_t message_box_index = 0; message_box_index < n_carriers; message_box_index++)
-        cp_buffer_init(&(scheduler->bus.message_boxes[message_box_index]));
-    scheduler->bus.foreign_message_box = &(scheduler->bus.message_boxes[index]);
+    scheduler->bus.parked = P7R_BUS_BUSY;
+    (scheduler->bus.stealing = 0), (scheduler->bus.steal_cursor = index + 1);
+    p7r_inbox_init(&(scheduler->bus.inbox));
+    scheduler->numa_node = config.numa_node;
+    if (unlikely(p7r_message_slab_init(&(scheduler->bus.slab), index, n_carriers, config.numa_node) == NULL)) {
+        // the first remote free would land on a NULL pending array - give back what we have and fail
+        stack_allocator_ruin(&(scheduler->runners.stack_allocator));
+        if (scheduler->bus.backend == P7R_BUS_BACKEND_URING)
+            p7r_uring_ruin(&(scheduler->bus.ring)), scraft_deallocate(allocator, scheduler->bus.ring_slots);
+        else
+            close(scheduler->bus.fd_epoll);
+        close(scheduler->bus.fd_notification);
+        __atomic_store_n(&(scheduler->status), P7R_SCHEDULER_DYING, __ATOMIC_RELEASE);
+        return NULL;
+    }
     p7r_timer_queue_init(&(scheduler->bus.timers));
     scheduler->bus.n_epoll_events = event_buffer_capacity;      // XXX We do not check anything - keep your sanity
     scheduler->bus.epoll_events = scraft_allocate(allocator, sizeof(struct epoll_event) * event_buffer_capacity);
@@ -443,26 +1270,30 @@ struct p7r_scheduler *p7r_scheduler_ruin(struct p7r_scheduler *scheduler) {
 
     // All uthreads will be destroyed with the corresponding stack allocator
     stack_allocator_ruin(&(scheduler->runners.stack_allocator));
+    sched_stack_hints_tracked(scheduler) && (p7r_stack_hint_dictionary_ruin(&(scheduler->runners.stack_hints)), 0);
 
     scraft_deallocate(allocator, scheduler->bus.epoll_events);
-    close(scheduler->bus.fd_epoll);
+    if (scheduler->bus.backend == P7R_BUS_BACKEND_URING)
+        p7r_uring_ruin(&(scheduler->bus.ring)), scraft_deallocate(allocator, scheduler->bus.ring_slots);
+    else
+        close(scheduler->bus.fd_epoll);
     close(scheduler->bus.fd_notification);
     {
-        list_ctl_t *p, *t;
-        for (uint32_t index = 0; index < 1; index++) {
-            list_foreach_remove(p, &(scheduler->bus.message_boxes->buffers[index]), t) {
-                list_del(t);
-                struct p7r_internal_message *message = container_of(t, struct p7r_internal_message, linkable);
-                if (message->content_destructor)
-                    message->content_destructor(message);
-            }
+        list_ctl_t messages, *p, *t;
+        init_list_head(&messages);
+        p7r_inbox_drain(&(scheduler->bus.inbox), &messages);
+        list_foreach_remove(p, &messages, t) {
+            list_del(t);
+            struct p7r_internal_message *message = container_of(t, struct p7r_internal_message, linkable);
+            if (message->content_destructor)
+                message->content_destructor(message);
         }
     }
-    scraft_deallocate(allocator, scheduler->bus.message_boxes);
+    p7r_message_slab_ruin(&(scheduler->bus.slab));
 
-    {
+    for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++) {
         list_ctl_t *p, *t;
-        list_foreach_remove(p, &(scheduler->runners.request_queue), t) {
+        list_foreach_remove(p, &(scheduler->runners.request_queues[priority]), t) {
             list_del(t);
             p7r_uthread_request_delete(container_of(t, struct p7r_uthread_request, linkable));
         }
@@ -504,13 +1335,14 @@ void *p7r_carrier_lifespan(void *self_argument) {
         if (request.user_entrance) {
             struct p7r_uthread *uthread = sched_uthread_from_request(scheduler, request, P7R_STACK_POLICY_DEFAULT);
             if (uthread)
-                list_add_tail(&(uthread->linkable), &(scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING]));
-            else if (request.user_argument_dtor)
-                request.user_argument_dtor(request.user_argument);
+                sched_runnable_enqueue(scheduler, uthread);
         }
         struct p7r_uthread *target = sched_resched_target(scheduler);
-        if (target)
+        if (target) {
+            sched_count(scheduler, n_switches);
+            sched_trace(scheduler, P7R_TRACE_SWITCH_IN, target, target->entrance.user_entrance, target->priority);
             p7r_context_switch(&(target->context), &(self->context));
+        }
     }
 
     return NULL;
@@ -519,54 +1351,98 @@ void *p7r_carrier_lifespan(void *self_argument) {
 
 // iuc & u2cc
 
+static inline
+struct p7r_message_slab *p7r_local_message_slab(void) {
+    return self_carrier ? &(self_carrier->scheduler->bus.slab) : NULL;
+}
+
 static
 void p7r_internal_message_delete(struct p7r_internal_message *message) {
+    if (message->slab) {
+        p7r_message_slab_free(p7r_local_message_slab(), message->slab, message);
+        return;
+    }
     __auto_type allocator = p7r_root_alloc_get_proxy();
     scraft_deallocate(allocator, message);
 }
 
 static
 struct p7r_internal_message *p7r_u2cc_message_raw(uint64_t base_type, size_t size_hint) {
-    __auto_type allocator = p7r_root_alloc_get_proxy();
-    struct p7r_internal_message *message = scraft_allocate(allocator, P7R_BUFFERED_MESSAGE_SIZE(size_hint));
-    if (unlikely(message == NULL))
-        return NULL;
-    message->type = base_type|P7R_INTERNAL_U2CC;
+    struct p7r_message_slab *slab = p7r_local_message_slab();
+    struct p7r_internal_message *message = NULL;
+    if (slab) {
+        if (likely(P7R_BUFFERED_MESSAGE_SIZE(size_hint) <= P7R_MESSAGE_SLAB_BLOCK_SIZE))
+            message = p7r_message_slab_allocate(slab);
+        else
+            p7r_message_slab_count(slab, n_bypassed);
+    }
+    if (message == NULL) {
+        __auto_type allocator = p7r_root_alloc_get_proxy();
+        if (unlikely((message = scraft_allocate(allocator, P7R_BUFFERED_MESSAGE_SIZE(size_hint))) == NULL))
+            return NULL;
+        slab = NULL;
+    }
+    (message->type = base_type|P7R_INTERNAL_U2CC), (message->slab = slab);
     return message;
 }
 
-static
-void p7r_u2cc_message_post(uint32_t dst_index, uint32_t src_index, struct p7r_internal_message *message) {
-    struct p7r_scheduler *destination = carriers[dst_index].scheduler;
-    cp_buffer_produce(&(destination->bus.message_boxes[src_index]), &(message->linkable));
-    {
+static inline
+void p7r_u2cc_knock(struct p7r_scheduler *destination) {
+    // a busy destination drains its inbox anyway - only the first producer after it parked has to knock
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&(destination->bus.parked), __ATOMIC_RELAXED) == P7R_BUS_PARKED &&
+            __atomic_exchange_n(&(destination->bus.parked), P7R_BUS_BUSY, __ATOMIC_RELAXED) == P7R_BUS_PARKED) {
         uint64_t event_notification = 1;
         write(destination->bus.fd_notification, &event_notification, sizeof(uint64_t));
     }
 }
 
+static
+void p7r_u2cc_message_post(uint32_t dst_index, uint32_t src_index, struct p7r_internal_message *message) {
+    struct p7r_scheduler *destination = carriers[dst_index].scheduler;
+    (message->from = src_index), (message->to = dst_index);
+    // gone to the destination once pushed - look at the type before
+    self_carrier && sched_trace(self_carrier->scheduler, P7R_TRACE_POST, dst_index, P7R_MESSAGE_REAL_TYPE(message->type), 1);
+    p7r_inbox_push(&(destination->bus.inbox), &(message->linkable));
+    self_carrier && (sched_count(self_carrier->scheduler, n_messages_sent), 0);
+    p7r_u2cc_knock(destination);
+}
+
+// messages already addressed, linked through linkable.next from the newest down to the oldest
+static
+void p7r_u2cc_message_post_chain(uint32_t dst_index, list_ctl_t *newest, list_ctl_t *oldest, uint32_t n_messages) {
+    struct p7r_scheduler *destination = carriers[dst_index].scheduler;
+    self_carrier && sched_trace(self_carrier->scheduler, P7R_TRACE_POST, dst_index,
+            P7R_MESSAGE_REAL_TYPE(container_of(newest, struct p7r_internal_message, linkable)->type), n_messages);
+    p7r_inbox_push_chain(&(destination->bus.inbox), newest, oldest);
+    p7r_u2cc_knock(destination);
+}
+
 
 // api & basement
 
 static
-int p7r_uthread_create_(void (*entrance)(void *), void *argument, void (*dtor)(void *)) {
-    uint32_t target_carrier_index = next_balance_index;
-    uint32_t n_carriers = self_carrier->scheduler->n_carriers;
+int p7r_uthread_create_(void (*entrance)(void *), void *argument, void (*dtor)(void *), uint32_t stack_class, uint32_t priority) {
+    uint32_t target_carrier_index = placement_unparked(placement.target_of(self_carrier->scheduler));
+    priority = sched_priority_of_spawn(priority);
 
     int remote_created;
 
-    if (remote_created = (target_carrier_index % n_carriers != self_carrier->index)) {
+    if (remote_created = (target_carrier_index != self_carrier->index)) {
         struct p7r_internal_message *request_message = p7r_u2cc_message_raw(P7R_MESSAGE_UTHREAD_REQUEST, sizeof(struct p7r_uthread_request));
         if (unlikely(request_message == NULL))
             return -1;
         struct p7r_uthread_request *request = (struct p7r_uthread_request *) &(request_message->content_buffer);
         (request->user_entrance = entrance), (request->user_argument = argument), (request->user_argument_dtor = dtor), (request->future = NULL);
-        p7r_u2cc_message_post(target_carrier_index % n_carriers, self_carrier->index, request_message);
+        (request->stack_class = stack_class), (request->priority = priority);
+        p7r_u2cc_message_post(target_carrier_index, self_carrier->index, request_message);
     } else {
-        struct p7r_uthread_request request = { .user_entrance = entrance, .user_argument = argument };
+        struct p7r_uthread_request request = { 
+            .user_entrance = entrance, .user_argument = argument, .user_argument_dtor = dtor, .stack_class = stack_class, .priority = priority 
+        };
         struct p7r_uthread *uthread = sched_uthread_from_request(self_carrier->scheduler, request, P7R_STACK_POLICY_DEFAULT);
         if (uthread)
-            list_add_tail(&(uthread->linkable), &(self_carrier->scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING]));
+            sched_runnable_enqueue(self_carrier->scheduler, uthread);
     }
 
     return remote_created;
@@ -577,7 +1453,7 @@ void p7r_blocking_point(void) {
     struct p7r_scheduler *self_scheduler = self_carrier->scheduler;
     struct p7r_uthread *self = self_scheduler->runners.running;
 
-    list_del(&(self->linkable));
+    sched_runnable_dequeue(self_scheduler, self);
     // TODO refactor - extract common code snippet
     p7r_uthread_change_state_clean(self, P7R_UTHREAD_BLOCKING);
     list_add_tail(&(self->linkable), &(self_scheduler->runners.sched_queues[P7R_SCHED_QUEUE_BLOCKING]));
@@ -596,35 +1472,34 @@ void p7r_blocking_point(void) {
 
 static inline
 int p7r_delegation_io_based(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation, int fd) {
-    int ret = 1;
     delegation->checked_events.io.fd = fd;
-    delegation->checked_events.io.epoll_event.events = 
-        ((delegation->p7r_event & P7R_DELEGATION_READ) ? EPOLLIN : 0) |
-        ((delegation->p7r_event & P7R_DELEGATION_WRITE) ? EPOLLOUT : 0) |
-        EPOLLONESHOT;
-    delegation->checked_events.io.epoll_event.data.ptr = delegation;
-    int fd_epoll = scheduler->bus.fd_epoll;
-    if (epoll_ctl(fd_epoll, EPOLL_CTL_MOD, fd, &(delegation->checked_events.io.epoll_event)) == -1)
-        if (errno == ENOENT)
-            (epoll_ctl(fd_epoll, EPOLL_CTL_ADD, fd,&(delegation->checked_events.io.epoll_event)) == 0) || (ret = 0);
+    int ret = sched_bus_backend(scheduler)->io_arm(scheduler, delegation);
     ret && ((delegation->checked_events.io.enabled = 1), (delegation->checked_events.io.triggered = 0));
     return ret;
 }
 
+// Returns 1 if the source is satisfied already - nothing left to wait for.
 static inline
-int p7r_delegation_iuc_based(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation) {
-    // TODO implementation
-    return 0;
+int p7r_delegation_iuc_based(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation, struct p7r_oob_source *source) {
+    // without a source the caller has put the delegation on some wait list itself - p7r_waiter_wake does the rest
+    (delegation->checked_events.oob.enabled = 1), (delegation->checked_events.oob.triggered = 0);
+    return source && (delegation->checked_events.oob.triggered = source->arm(source, delegation));
 }
 
 static inline
 int p7r_delegation_timed(struct p7r_scheduler *scheduler, struct p7r_delegation *delegation, uint64_t dt) {
     p7r_timer_core_init_diff(&(delegation->checked_events.timer.measurement), dt, scheduler->runners.running);
+    p7r_timer_core_attach(&(scheduler->bus.timers), &(delegation->checked_events.timer.measurement));
     (delegation->checked_events.timer.enabled = 1), (delegation->checked_events.timer.triggered = 0);
     return 1;
 }
 
-int p7r_uthread_create_foreign(uint32_t target_carrier_index, void (*entrance)(void *), void *argument, void (*dtor)(void *), struct p7r_future *future) {
+int p7r_uthread_create_foreign(
+        uint32_t target_carrier_index, 
+        void (*entrance)(void *), void *argument, void (*dtor)(void *), 
+        struct p7r_future *future, 
+        uint32_t stack_class,
+        uint32_t priority) {
     uint32_t n_carriers = carriers[target_carrier_index].scheduler->n_carriers;
 
     struct p7r_internal_message *request_message = p7r_u2cc_message_raw(P7R_MESSAGE_UTHREAD_REQUEST, sizeof(struct p7r_uthread_request));
@@ -632,11 +1507,41 @@ int p7r_uthread_create_foreign(uint32_t target_carrier_index, void (*entrance)(v
         return -1;
     struct p7r_uthread_request *request = (struct p7r_uthread_request *) &(request_message->content_buffer);
     (request->user_entrance = entrance), (request->user_argument = argument), (request->user_argument_dtor = dtor), (request->future = future);
+    (request->stack_class = stack_class), (request->priority = sched_priority_of_spawn(priority));
     p7r_u2cc_message_post(target_carrier_index % n_carriers, carriers[target_carrier_index % n_carriers].index, request_message);
 
     return 0;
 }
 
+uint32_t p7r_uthread_create_foreign_batch(const struct p7r_task *tasks, struct p7r_future *const *futures, uint32_t n_tasks) {
+    uint32_t n = p7r_n_carriers(), first = balanced_target_carrier() % n, n_posted, priority = sched_priority_of_spawn(P7R_PRIORITY_INHERIT);
+    list_ctl_t *newest[n], *oldest[n];
+    uint32_t n_chained[n];
+    memset(newest, 0, sizeof(list_ctl_t *) * n), memset(n_chained, 0, sizeof(uint32_t) * n);
+
+    for (n_posted = 0; n_posted < n_tasks; n_posted++) {
+        struct p7r_internal_message *request_message = p7r_u2cc_message_raw(P7R_MESSAGE_UTHREAD_REQUEST, sizeof(struct p7r_uthread_request));
+        if (unlikely(request_message == NULL))
+            break;
+        uint32_t target_carrier_index = placement_unparked((first + n_posted) % n);
+        struct p7r_uthread_request *request = (struct p7r_uthread_request *) &(request_message->content_buffer);
+        (request->user_entrance = tasks[n_posted].entrance), (request->user_argument = tasks[n_posted].argument);
+        (request->user_argument_dtor = tasks[n_posted].dtor), (request->future = futures ? futures[n_posted] : NULL);
+        (request->stack_class = P7R_STACK_CLASS_AUTO), (request->priority = priority);
+        (request_message->from = self_carrier ? self_carrier->index : target_carrier_index), (request_message->to = target_carrier_index);
+        list_ctl_t *request_link = P7R_MESSAGE_LINK_OF(request_message);
+        (newest[target_carrier_index] == NULL) && (oldest[target_carrier_index] = request_link);
+        (request_link->next = newest[target_carrier_index]), (newest[target_carrier_index] = request_link);
+        n_chained[target_carrier_index]++;
+    }
+
+    for (uint32_t target_carrier_index = 0; target_carrier_index < n; target_carrier_index++)
+        newest[target_carrier_index] && 
+            (p7r_u2cc_message_post_chain(target_carrier_index, newest[target_carrier_index], oldest[target_carrier_index], n_chained[target_carrier_index]), 0);
+    self_carrier && (sched_count_add(self_carrier->scheduler, n_messages_sent, n_posted), 0);
+    return n_posted;
+}
+
 void p7r_yield(void) {
     struct p7r_scheduler *self_scheduler = self_carrier->scheduler;
     struct p7r_uthread *self = self_scheduler->runners.running;
@@ -646,43 +1551,453 @@ void p7r_yield(void) {
     p7r_uthread_switch(target, self);
 }
 
-int p7r_uthread_create(void (*entrance)(void *), void *argument, void (*dtor)(void *), int yield) {
-    int remote_created = p7r_uthread_create_(entrance, argument, dtor);
+int p7r_uthread_create_sized(void (*entrance)(void *), void *argument, void (*dtor)(void *), int yield, uint32_t stack_class) {
+    int remote_created = p7r_uthread_create_(entrance, argument, dtor, stack_class, P7R_PRIORITY_INHERIT);
     if (yield && !remote_created)
         p7r_yield();
     return remote_created;
 }
 
+int p7r_uthread_create_prioritized(void (*entrance)(void *), void *argument, void (*dtor)(void *), int yield, uint32_t priority) {
+    int remote_created = p7r_uthread_create_(entrance, argument, dtor, P7R_STACK_CLASS_AUTO, priority);
+    if (yield && !remote_created)
+        p7r_yield();
+    return remote_created;
+}
+
+uint32_t p7r_priority(void) {
+    return self_carrier->scheduler->runners.running->priority;
+}
+
+// takes effect from the next switch on - the running uthread changes queues only when it gets off the carrier
+void p7r_set_priority(uint32_t priority) {
+    self_carrier->scheduler->runners.running->priority = (priority < P7R_N_PRIORITIES) ? priority : P7R_PRIORITY_BACKGROUND;
+}
+
+int p7r_uthread_create(void (*entrance)(void *), void *argument, void (*dtor)(void *), int yield) {
+    return p7r_uthread_create_sized(entrance, argument, dtor, yield, P7R_STACK_CLASS_AUTO);
+}
+
 struct p7r_delegation p7r_delegate(uint64_t events, ...) {
     struct p7r_scheduler *self_scheduler = self_carrier->scheduler;
     struct p7r_delegation delegation = { .uthread = self_scheduler->runners.running };
+    struct p7r_oob_source *oob_source = NULL;
+    int fd = -1;
+    uint64_t dt = 0;
 
     delegation.p7r_event = events;
 
+    // arguments come in the order of the flags: fd, oob source, timeout
     va_list arguments;
     va_start(arguments, events);
+    if (events & (P7R_DELEGATION_READ|P7R_DELEGATION_WRITE))
+        fd = va_arg(arguments, int);
+    if (events & P7R_DELEGATION_ALLOW_OOB)
+        oob_source = va_arg(arguments, struct p7r_oob_source *);
+    if (events & P7R_DELEGATION_TIMED)
+        dt = va_arg(arguments, uint64_t);
+    va_end(arguments);
 
-    if (events & (P7R_DELEGATION_READ|P7R_DELEGATION_WRITE)) 
-        p7r_delegation_io_based(self_scheduler, &delegation, va_arg(arguments, int));
+    // a source satisfied on the spot spares us both the park and the registrations
+    if ((events & P7R_DELEGATION_ALLOW_OOB) && p7r_delegation_iuc_based(self_scheduler, &delegation, oob_source))
+        return delegation;
 
-    if (events & P7R_DELEGATION_ALLOW_OOB)
-        p7r_delegation_iuc_based(self_scheduler, &delegation);
+    if (events & (P7R_DELEGATION_READ|P7R_DELEGATION_WRITE)) 
+        p7r_delegation_io_based(self_scheduler, &delegation, fd);
 
     if (events & P7R_DELEGATION_TIMED)
-        p7r_delegation_timed(self_scheduler, &delegation, va_arg(arguments, uint64_t));
-
-    va_end(arguments);
+        p7r_delegation_timed(self_scheduler, &delegation, dt);
 
     // XXX as-fair-as-possible schedule
+    sched_trace(self_scheduler, P7R_TRACE_BLOCK, delegation.uthread, (int64_t) fd, events);
     p7r_blocking_point();
+    delegation.checked_events.timer.triggered = delegation.checked_events.timer.measurement.triggered;
+
+    // woken up by the timer - the i/o registration must not outlive this frame
+    if (delegation.checked_events.io.enabled && !delegation.checked_events.io.triggered)
+        sched_bus_backend(self_scheduler)->io_disarm(self_scheduler, &delegation);
+
+    // the source claimed us before we could leave - its wake is on the way, and so is whatever it completed
+    if (oob_source && !delegation.checked_events.oob.triggered && !oob_source->disarm(oob_source, &delegation))
+        while (!delegation.checked_events.oob.triggered)
+            p7r_blocking_point();
 
     return delegation;
 }
 
+static
+int32_t p7r_ring_operation(struct p7r_scheduler *scheduler, uint8_t opcode, int fd, uint64_t addr, uint64_t len_or_addr2, uint32_t flags) {
+    struct p7r_delegation delegation = { .uthread = scheduler->runners.running };
+    struct io_uring_sqe *sqe = bus_uring_sqe_for(scheduler, &delegation, opcode, fd);
+    if (unlikely(sqe == NULL))
+        return -ENOMEM;
+    sqe->addr = addr;
+    if (opcode == IORING_OP_ACCEPT)
+        (sqe->addr2 = len_or_addr2), (sqe->accept_flags = flags);
+    else
+        (sqe->len = (uint32_t) len_or_addr2), (sqe->off = (uint64_t) -1);
+    (delegation.checked_events.io.enabled = 1), (delegation.checked_events.io.triggered = 0);
+    sched_trace(scheduler, P7R_TRACE_BLOCK, delegation.uthread, (int64_t) fd, P7R_DELEGATION_READ|P7R_DELEGATION_WRITE);
+    p7r_blocking_point();
+    return delegation.checked_events.io.result;
+}
+
+static inline
+int p7r_ring_operations_enabled(struct p7r_scheduler *scheduler) {
+    return (scheduler->bus.backend == P7R_BUS_BACKEND_URING) && scheduler->bus.ring_operations;
+}
+
+// Either the ring does the whole job, or we wait for readiness and do it ourselves - EAGAIN from the ring included.
+// Out of slots (ENOMEM), we let the scheduler reap some and take the syscall way for this one.
+#define     p7r_io_loop(opcode_, delegation_event_, fd_, addr_, len_, flags_, syscall_)            \
+    do {                                                                                            \
+        struct p7r_scheduler *self_scheduler = self_carrier->scheduler;                             \
+        int through_ring = p7r_ring_operations_enabled(self_scheduler);                                    \
+        for (;;) {                                                                                  \
+            if (through_ring) {                                                                      \
+                int32_t result = p7r_ring_operation(self_scheduler, (opcode_), (fd_), (addr_), (len_), (flags_));     \
+                if ((result != -EAGAIN) && (result != -ENOMEM))                                     \
+                    return (result < 0) ? ((errno = -result), -1) : result;                         \
+                if (result == -EAGAIN) {                                                            \
+                    p7r_delegate((delegation_event_), (fd_));                                       \
+                    continue;                                                                       \
+                }                                                                                   \
+                (through_ring = 0), p7r_yield();                                                       \
+            }                                                                                       \
+            __auto_type ret = (syscall_);                                                           \
+            if ((ret >= 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))                        \
+                return ret;                                                                         \
+            p7r_delegate((delegation_event_), (fd_));                                               \
+        }                                                                                           \
+    } while (0)
+
+ssize_t p7r_read(int fd, void *buffer, size_t size) {
+    p7r_io_loop(IORING_OP_READ, P7R_DELEGATION_READ, fd, (uint64_t) buffer, size, 0, read(fd, buffer, size));
+}
+
+ssize_t p7r_write(int fd, const void *buffer, size_t size) {
+    p7r_io_loop(IORING_OP_WRITE, P7R_DELEGATION_WRITE, fd, (uint64_t) buffer, size, 0, write(fd, buffer, size));
+}
+
+int p7r_accept(int fd, struct sockaddr *address, socklen_t *address_length, int flags) {
+    p7r_io_loop(IORING_OP_ACCEPT, P7R_DELEGATION_READ, fd, (uint64_t) address, (uint64_t) address_length, flags, accept4(fd, address, address_length, flags));
+}
+
 struct p7r_future *p7r_get_future(void) {
     return self_carrier->scheduler->runners.running->future;
 }
 
+int p7r_fd_register(struct p7r_fd *handle, int fd) {
+    struct p7r_scheduler *self_scheduler = self_carrier->scheduler;
+    memset(handle, 0, sizeof(struct p7r_fd));
+    init_list_head(&(handle->waiters[P7R_FD_WAITER_READ])), init_list_head(&(handle->waiters[P7R_FD_WAITER_WRITE]));
+    (handle->fd = fd), (handle->scheduler_index = self_scheduler->index);
+    // nothing is known yet - the first transfer finds out
+    handle->ready = P7R_DELEGATION_READ|P7R_DELEGATION_WRITE;
+    (handle->registration.p7r_event = P7R_DELEGATION_PERSISTENT), (handle->registration.checked_events.io.fd = fd);
+    return sched_bus_backend(self_scheduler)->fd_register(self_scheduler, handle) ? 0 : -1;
+}
+
+void p7r_fd_unregister(struct p7r_fd *handle) {
+    struct p7r_scheduler *scheduler = &(schedulers[handle->scheduler_index]);
+    sched_bus_backend(scheduler)->fd_unregister(scheduler, handle);
+}
+
+struct p7r_delegation p7r_fd_wait(struct p7r_fd *handle, uint64_t events, ...) {
+    struct p7r_scheduler *self_scheduler = self_carrier->scheduler;
+    uint64_t dt = 0;
+    if (events & P7R_DELEGATION_TIMED) {
+        va_list arguments;
+        va_start(arguments, events);
+        dt = va_arg(arguments, uint64_t);
+        va_end(arguments);
+    }
+    // registered elsewhere - no edges will ever reach us here, take the one-shot way
+    if (unlikely(handle->scheduler_index != self_scheduler->index))
+        return (events & P7R_DELEGATION_TIMED) ? p7r_delegate(events, handle->fd, dt) : p7r_delegate(events, handle->fd);
+
+    struct p7r_delegation delegation = { .uthread = self_scheduler->runners.running, .p7r_event = events };
+    delegation.checked_events.io.fd = handle->fd;
+    if (handle->ready & events & (P7R_DELEGATION_READ|P7R_DELEGATION_WRITE)) {
+        delegation.checked_events.io.triggered = 1;
+        return delegation;
+    }
+    struct p7r_fd_waiter waiter = { .delegation = &delegation };
+    for (int direction = P7R_FD_WAITER_READ; direction <= P7R_FD_WAITER_WRITE; direction++)
+        (events & (P7R_DELEGATION_READ << direction)) ?
+            list_add_tail(&(waiter.linkable[direction]), &(handle->waiters[direction])) : list_node_isolate(&(waiter.linkable[direction]));
+    delegation.checked_events.io.enabled = 1;
+    if (events & P7R_DELEGATION_TIMED)
+        p7r_delegation_timed(self_scheduler, &delegation, dt);
+
+    sched_trace(self_scheduler, P7R_TRACE_BLOCK, delegation.uthread, (int64_t) handle->fd, events);
+    p7r_blocking_point();
+
+    // the timer got there first - leave the queues
+    sched_fd_waiter_leave(&waiter);
+    delegation.checked_events.timer.triggered = delegation.checked_events.timer.measurement.triggered;
+    return delegation;
+}
+
+// A short transfer on an edge-triggered fd means it is drained (or full) - no need to hear EAGAIN to know.
+#define     p7r_fd_transfer_loop(handle_, direction_, syscall_, size_)                                 \
+    do {                                                                                            \
+        for (;;) {                                                                                  \
+            if (!((handle_)->ready & (direction_)))                                                 \
+                p7r_fd_wait((handle_), (direction_));                                               \
+            __auto_type ret = (syscall_);                                                           \
+            if (ret >= 0) {                                                                         \
+                ((size_t) ret < (size_)) && ((handle_)->ready &= ~(direction_));                    \
+                return ret;                                                                         \
+            }                                                                                       \
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK))                                        \
+                return ret;                                                                         \
+            (handle_)->ready &= ~(direction_);                                                      \
+        }                                                                                           \
+    } while (0)
+
+ssize_t p7r_fd_read(struct p7r_fd *handle, void *buffer, size_t size) {
+    p7r_fd_transfer_loop(handle, P7R_DELEGATION_READ, read(handle->fd, buffer, size), size);
+}
+
+ssize_t p7r_fd_write(struct p7r_fd *handle, const void *buffer, size_t size) {
+    p7r_fd_transfer_loop(handle, P7R_DELEGATION_WRITE, write(handle->fd, buffer, size), size);
+}
+
+int p7r_fd_accept(struct p7r_fd *handle, struct sockaddr *address, socklen_t *address_length, int flags) {
+    // one connection per call - a backlog is drained only when accept says so
+    p7r_fd_transfer_loop(handle, P7R_DELEGATION_READ, accept4(handle->fd, address, address_length, flags), 0);
+}
+
+int p7r_in_uthread(void) {
+    return self_carrier && self_carrier->scheduler->runners.running;
+}
+
+struct p7r_delegation *p7r_waiter_prepare(struct p7r_delegation *waiter) {
+    struct p7r_scheduler *self_scheduler = self_carrier->scheduler;
+    memset(waiter, 0, sizeof(struct p7r_delegation));
+    (waiter->uthread = self_scheduler->runners.running), (waiter->p7r_event = P7R_DELEGATION_ALLOW_OOB);
+    p7r_delegation_iuc_based(self_scheduler, waiter, NULL);
+    return waiter;
+}
+
+int p7r_waiter_park(struct p7r_delegation *waiter, uint64_t timeout_ms) {
+    struct p7r_scheduler *self_scheduler = self_carrier->scheduler;
+    // a second park only ever collects a wake already claimed - no timer then
+    (waiter->checked_events.timer.enabled = 0), (waiter->checked_events.timer.measurement.triggered = 0);
+    if (timeout_ms)
+        p7r_delegation_timed(self_scheduler, waiter, timeout_ms);
+    sched_trace(self_scheduler, P7R_TRACE_BLOCK, waiter->uthread, (int64_t) -1, waiter->p7r_event|(timeout_ms ? P7R_DELEGATION_TIMED : 0));
+    while (!waiter->checked_events.oob.triggered && !waiter->checked_events.timer.measurement.triggered)
+        p7r_blocking_point();
+    waiter->checked_events.timer.triggered = waiter->checked_events.timer.measurement.triggered;
+    return waiter->checked_events.oob.triggered;
+}
+
+void p7r_waiter_wake(struct p7r_delegation *waiter) {
+    uint32_t target_index = waiter->uthread->scheduler_index;
+    if (self_carrier && (self_carrier->index == target_index)) {
+        sched_delegation_wake(self_carrier->scheduler, waiter);
+        return;
+    }
+    // the waiter's own message, as it stays until this wake arrives - any oob delegation carries one
+    waiter->checked_events.oob.wakeup.type = P7R_MESSAGE_WAKEUP|P7R_INTERNAL_U2CC;
+    p7r_u2cc_message_post(target_index, self_carrier ? self_carrier->index : target_index, &(waiter->checked_events.oob.wakeup));
+}
+
+struct p7r_stack_zone_stat p7r_stack_stat(uint32_t carrier_index, uint32_t zone) {
+    return p7r_stack_allocator_stat(&(schedulers[carrier_index].runners.stack_allocator), zone);
+}
+
+struct p7r_stack_zone_stat p7r_stack_class_stat(uint32_t carrier_index, uint32_t size_class, uint32_t zone) {
+    return p7r_stack_allocator_class_stat(&(schedulers[carrier_index].runners.stack_allocator), size_class, zone);
+}
+
+// hashtables are owner-only, foreign readers walk the registration list instead
+static
+struct p7r_stack_hint *p7r_stack_profile_find(struct p7r_scheduler *scheduler, void (*entrance)(void *)) {
+    struct p7r_stack_hint *hint = __atomic_load_n(&(scheduler->runners.stack_hints.registered), __ATOMIC_ACQUIRE);
+    while (hint && (hint->key.solid_entrance != entrance))
+        hint = hint->next_registered;
+    return hint;
+}
+
+static
+void p7r_stack_profile_merge(struct p7r_hint_depth_stat *into, struct p7r_stack_hint *hint) {
+    struct p7r_hint_depth_stat *from = &(hint->depth_stat);
+    uint64_t max = __atomic_load_n(&(from->max), __ATOMIC_RELAXED);
+    into->n_samples += __atomic_load_n(&(from->n_samples), __ATOMIC_RELAXED);
+    (max > into->max) && (into->max = max);
+    for (uint32_t bucket = 0; bucket < P7R_STACK_DEPTH_N_BUCKETS; bucket++)
+        into->histogram[bucket] += __atomic_load_n(&(from->histogram[bucket]), __ATOMIC_RELAXED);
+}
+
+void p7r_stack_profile_dump(FILE *stream) {
+    uint32_t n = p7r_n_carriers();
+    for (uint32_t index = 0; index < n; index++) {
+        if (!schedulers[index].policy.stack_placement.profile)
+            continue;
+        struct p7r_stack_hint *hint = __atomic_load_n(&(schedulers[index].runners.stack_hints.registered), __ATOMIC_ACQUIRE);
+        for (; hint; hint = hint->next_registered) {
+            // every carrier keeps its own hint per entrance, the first carrier that has it prints the sum
+            void (*entrance)(void *) = hint->key.solid_entrance;
+            int printed = 0;
+            for (uint32_t earlier = 0; (earlier < index) && !printed; earlier++)
+                printed = schedulers[earlier].policy.stack_placement.profile && (p7r_stack_profile_find(&(schedulers[earlier]), entrance) != NULL);
+            if (printed)
+                continue;
+            struct p7r_hint_depth_stat total;
+            memset(&total, 0, sizeof(struct p7r_hint_depth_stat));
+            p7r_stack_profile_merge(&total, hint);
+            for (uint32_t later = index + 1; later < n; later++) {
+                struct p7r_stack_hint *peer = schedulers[later].policy.stack_placement.profile ? p7r_stack_profile_find(&(schedulers[later]), entrance) : NULL;
+                peer && (p7r_stack_profile_merge(&total, peer), 0);
+            }
+            Dl_info info;
+            const char *name = (dladdr((void *) entrance, &info) && info.dli_sname) ? info.dli_sname : "?";
+            fprintf(stream, "%s (%p): samples %lu max %lu bytes\n", name, (void *) entrance, total.n_samples, total.max);
+            for (uint32_t bucket = 0; bucket < P7R_STACK_DEPTH_N_BUCKETS - 1; bucket++)
+                total.histogram[bucket] && fprintf(stream, "    <  %6lu KiB: %lu\n", (uint64_t) 1 << bucket, total.histogram[bucket]);
+            total.histogram[P7R_STACK_DEPTH_N_BUCKETS - 1] && fprintf(stream, "    >= %6lu KiB: %lu\n",
+                    (uint64_t) 1 << (P7R_STACK_DEPTH_N_BUCKETS - 2), total.histogram[P7R_STACK_DEPTH_N_BUCKETS - 1]);
+        }
+    }
+}
+
+uint32_t p7r_bus_backend(uint32_t carrier_index) {
+    return schedulers[carrier_index].bus.backend;
+}
+
+const struct p7r_carrier_counters *p7r_counters(uint32_t carrier_index) {
+    return &(counters_segment->carriers[carrier_index]);
+}
+
+static
+const char *trace_name_of_symbol(uint64_t entrance, char *buffer, size_t size, void *context) {
+    Dl_info info;
+    if (!dladdr((void *) entrance, &info))
+        return NULL;
+    // static functions have no symbol to show - their object and offset do, as the tool shows them
+    const char *file = info.dli_fname ? strrchr(info.dli_fname, '/') : NULL;
+    info.dli_sname ? snprintf(buffer, size, "%s", info.dli_sname) :
+        snprintf(buffer, size, "%s+0x%lx", file ? file + 1 : "?", entrance - (uint64_t) info.dli_fbase);
+    return buffer;
+}
+
+int64_t p7r_trace_dump(FILE *stream) {
+    return p7r_trace_export_chrome(stream, trace_segment, trace_name_of_symbol, NULL);
+}
+
+struct p7r_message_slab_stat p7r_message_stat(uint32_t carrier_index) {
+    struct p7r_message_slab_stat stat, *source = &(schedulers[carrier_index].bus.slab.stat);
+    stat.n_allocated = __atomic_load_n(&(source->n_allocated), __ATOMIC_RELAXED);
+    stat.n_bypassed = __atomic_load_n(&(source->n_bypassed), __ATOMIC_RELAXED);
+    stat.n_chunks = __atomic_load_n(&(source->n_chunks), __ATOMIC_RELAXED);
+    stat.n_freed_local = __atomic_load_n(&(source->n_freed_local), __ATOMIC_RELAXED);
+    stat.n_freed_remote = __atomic_load_n(&(source->n_freed_remote), __ATOMIC_RELAXED);
+    stat.n_return_batches = __atomic_load_n(&(source->n_return_batches), __ATOMIC_RELAXED);
+    stat.n_reclaimed = __atomic_load_n(&(source->n_reclaimed), __ATOMIC_RELAXED);
+    return stat;
+}
+
+// Private memory when no memfd is asked for, or none is to be had - the counters are kept either way.
+static
+struct p7r_counters_segment *counters_segment_map(uint32_t n_carriers_total, int exported) {
+    size_t size = P7R_COUNTERS_SEGMENT_SIZE(n_carriers_total);
+    void *segment = MAP_FAILED;
+    // the fd stays open for as long as the process lives - readers find the segment through it
+    int fd = exported ? memfd_create(P7R_COUNTERS_NAME, MFD_CLOEXEC) : -1;
+    if (fd != -1) {
+        (ftruncate(fd, size) == 0) && ((segment = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)), 0);
+        (segment == MAP_FAILED) && (close(fd), 0);
+    }
+    (segment == MAP_FAILED) && (segment = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+    if (segment == MAP_FAILED)
+        return NULL;
+    struct p7r_counters_segment *header = segment;
+    (header->version = P7R_COUNTERS_VERSION), (header->n_carriers = n_carriers_total), (header->pid = (uint64_t) getpid());
+    // readers look at the magic first
+    __atomic_store_n(&(header->magic), P7R_COUNTERS_MAGIC, __ATOMIC_RELEASE);
+    return header;
+}
+
+// Always a memfd when there is one - tracing is asked for by whoever wants to read it, from wherever.
+static
+struct p7r_trace_segment *trace_segment_map(uint32_t n_carriers_total, uint32_t n_events) {
+    uint64_t n_events_ring = 1;
+    n_events || (n_events = P7R_TRACE_DEFAULT_EVENTS);
+    while (n_events_ring < n_events)
+        n_events_ring <<= 1;
+    size_t size = P7R_TRACE_SEGMENT_SIZE(n_carriers_total, n_events_ring);
+    void *segment = MAP_FAILED;
+    int fd = memfd_create(P7R_TRACE_NAME, MFD_CLOEXEC);
+    if (fd != -1) {
+        (ftruncate(fd, size) == 0) && ((segment = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0)), 0);
+        (segment == MAP_FAILED) && (close(fd), 0);
+    }
+    (segment == MAP_FAILED) && (segment = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+    if (segment == MAP_FAILED)
+        return NULL;
+    struct p7r_trace_segment *header = segment;
+    (header->version = P7R_TRACE_VERSION), (header->n_carriers = n_carriers_total), (header->pid = (uint64_t) getpid());
+    header->n_events = n_events_ring;
+    (header->tsc_origin = __builtin_ia32_rdtsc()), (header->ns_origin = get_timestamp_ns_monotonic());
+    for (uint32_t index = 0; index < n_carriers_total; index++)
+        p7r_trace_ring_of(header, index)->mask = n_events_ring - 1;
+    __atomic_store_n(&(header->magic), P7R_TRACE_MAGIC, __ATOMIC_RELEASE);
+    return header;
+}
+
+static
+int carrier_busy_polls(struct p7r_config *config, uint32_t index) {
+    if (config->concurrency.busy_poll.carriers == NULL)
+        return 1;
+    for (uint32_t position = 0; position < config->concurrency.busy_poll.n_carriers; position++)
+        if (config->concurrency.busy_poll.carriers[position] == index)
+            return 1;
+    return 0;
+}
+
+// CPUs of a carrier under config.concurrency.affinity, and the node of the first one - no CPUs for an unpinned carrier
+static
+uint32_t carrier_affinity(struct p7r_config *config, uint32_t index, cpu_set_t *cpu_set, uint32_t *node) {
+    uint32_t width = config->concurrency.affinity.width ? config->concurrency.affinity.width : 1;
+    uint32_t n_cpus = config->concurrency.affinity.n_cpus, allowed[CPU_SETSIZE];
+    const uint32_t *cpus = config->concurrency.affinity.cpus;
+    CPU_ZERO(cpu_set);
+    *node = P7R_NUMA_ANYWHERE;
+    if (!config->concurrency.affinity.pinned)
+        return 0;
+    if (cpus == NULL) {
+        cpu_set_t process;
+        if (sched_getaffinity(0, sizeof(cpu_set_t), &process) == -1)
+            return 0;
+        n_cpus = 0;
+        for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            CPU_ISSET(cpu, &process) && (allowed[n_cpus++] = cpu);
+        cpus = allowed;
+    }
+    if (n_cpus == 0)
+        return 0;
+    for (uint32_t offset = 0; offset < width; offset++) {
+        uint32_t cpu = cpus[(index * width + offset) % n_cpus];
+        (cpu < CPU_SETSIZE) && (CPU_SET(cpu, cpu_set), 0);
+    }
+    config->concurrency.affinity.numa_local && (*node = p7r_numa_node_of_cpu(cpus[(index * width) % n_cpus]));
+    return CPU_COUNT(cpu_set);
+}
+
+// what p7r_init maps and allocates for the pool as a whole, on its way out after a failure
+static
+void pool_release(uint32_t n_carriers_mapped, cpu_set_t *cpu_sets) {
+    __auto_type allocator = p7r_root_alloc_get_proxy();
+    p7r_numa_unmap(schedulers, sizeof(struct p7r_scheduler) * n_carriers_mapped);
+    counters_segment && (munmap(counters_segment, P7R_COUNTERS_SEGMENT_SIZE(n_carriers_mapped)), 0);
+    trace_segment && (munmap(trace_segment, P7R_TRACE_SEGMENT_SIZE(n_carriers_mapped, trace_segment->n_events)), 0);
+    (carriers && (scraft_deallocate(allocator, carriers), 0)), (cpu_sets && (scraft_deallocate(allocator, cpu_sets), 0));
+    (schedulers = NULL), (carriers = NULL), (counters_segment = NULL), (trace_segment = NULL);
+}
+
 int p7r_init(struct p7r_config config) {
     srand((unsigned) time(NULL));
 
@@ -694,26 +2009,78 @@ int p7r_init(struct p7r_config config) {
     }
 
     __auto_type allocator = p7r_root_alloc_get_proxy();
-    schedulers = scraft_allocate(allocator, sizeof(struct p7r_scheduler) * config.concurrency.n_carriers);
+    placement.target_of = (config.concurrency.placement.policy < P7R_N_PLACEMENT_POLICIES) ?
+        p7r_placement_policies[config.concurrency.placement.policy] : placement_round_robin;
+    placement.saturation = 
+        config.concurrency.placement.saturation ? config.concurrency.placement.saturation : P7R_PLACEMENT_DEFAULT_SATURATION;
+    (elastic.n_parked = 0), (elastic.min_unparked = config.concurrency.elastic.min_carriers ? config.concurrency.elastic.min_carriers : 1);
+    elastic.unpark_depth = config.concurrency.elastic.unpark_depth ? config.concurrency.elastic.unpark_depth : P7R_ELASTIC_DEFAULT_UNPARK_DEPTH;
+
+    // mapped rather than allocated - every scheduler gets pages of its own, untouched until it is set up
+    schedulers = p7r_numa_map(sizeof(struct p7r_scheduler) * config.concurrency.n_carriers, P7R_NUMA_ANYWHERE);
     carriers = scraft_allocate(allocator, sizeof(struct p7r_carrier) * config.concurrency.n_carriers);
+    cpu_set_t *cpu_sets = scraft_allocate(allocator, sizeof(cpu_set_t) * config.concurrency.n_carriers);
+    counters_segment = counters_segment_map(config.concurrency.n_carriers, config.counters.exported);
+    // a trace which cannot be had is no reason not to run
+    trace_segment = config.trace.enabled ? trace_segment_map(config.concurrency.n_carriers, config.trace.n_events) : NULL;
     n_carriers = config.concurrency.n_carriers;
-    if (!schedulers || !carriers) {
-        (!schedulers && (scraft_deallocate(allocator, schedulers), 0)), (!carriers && (scraft_deallocate(allocator, carriers), 0));
-        return -1;
-    }
+    if (!schedulers || !carriers || !cpu_sets || !counters_segment)
+        return pool_release(config.concurrency.n_carriers, cpu_sets), -1;
     for (uint32_t index = 0; index < config.concurrency.n_carriers; index++) {
         (carriers[index].index = index), (carriers[index].scheduler = &(schedulers[index]));
-        p7r_scheduler_init(
+        carrier_affinity(&config, index, &(cpu_sets[index]), &(config.stack_allocator.numa_node));
+        p7r_numa_prefer(&(schedulers[index]), sizeof(struct p7r_scheduler), config.stack_allocator.numa_node);
+        struct p7r_scheduler *scheduler = p7r_scheduler_init(
                 &(schedulers[index]), 
                 index, 
                 config.concurrency.n_carriers, 
                 &(carriers[index].context), 
                 config.stack_allocator, 
-                config.concurrency.event_buffer_capacity
+                config.concurrency.event_buffer_capacity,
+                config.concurrency.bus.backend,
+                config.concurrency.bus.ring_entries
         );
+        if (unlikely(scheduler == NULL)) {
+            // no thread runs yet - the ones set up so far simply go down again
+            while (index)
+                p7r_scheduler_ruin(&(schedulers[--index]));
+            return pool_release(config.concurrency.n_carriers, cpu_sets), -1;
+        }
+        schedulers[index].bus.ring_operations = config.concurrency.bus.ring_operations;
+        (schedulers[index].counters = &(counters_segment->carriers[index])), (schedulers[index].n_refreshes = 0);
+        schedulers[index].trace = trace_segment ? p7r_trace_ring_of(trace_segment, index) : NULL;
         // TODO init policy
         (schedulers[index].policy.swarm.enabled = config.concurrency.swarm.enabled),
             (schedulers[index].policy.swarm.max_tokens = config.concurrency.swarm.max_tokens);
+        (schedulers[index].policy.stealing.enabled = config.concurrency.stealing.enabled),
+            (schedulers[index].policy.stealing.threshold = 
+                config.concurrency.stealing.threshold ? config.concurrency.stealing.threshold : P7R_STEAL_DEFAULT_THRESHOLD);
+        // without room for hints placement just stays static, and nothing gets profiled
+        (schedulers[index].policy.stack_placement.adaptive = config.stack_placement.adaptive),
+            (schedulers[index].policy.stack_placement.profile = config.stack_allocator.high_water_profile);
+        sched_stack_hints_tracked(&(schedulers[index])) &&
+            (sched_stack_hints_init(&(schedulers[index]), config.stack_placement.n_hints) != 0) &&
+            (schedulers[index].policy.stack_placement.adaptive = schedulers[index].policy.stack_placement.profile = 0);
+        (schedulers[index].policy.stack_placement.eden_below_us = 
+            config.stack_placement.eden_below_us ? config.stack_placement.eden_below_us : P7R_STACK_HINT_DEFAULT_EDEN_BELOW_US),
+            (schedulers[index].policy.stack_placement.prudent_above_us = 
+                config.stack_placement.prudent_above_us ? config.stack_placement.prudent_above_us : P7R_STACK_HINT_DEFAULT_PRUDENT_ABOVE_US);
+        {
+            static const uint32_t default_weights[P7R_N_PRIORITIES] = P7R_DISPATCH_DEFAULT_WEIGHTS;
+            int weighted = 0;
+            for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++)
+                weighted |= config.concurrency.dispatch.weights[priority] != 0;
+            // a priority of weight 0 would never start a round - 1 at least
+            schedulers[index].policy.dispatch.strict = config.concurrency.dispatch.strict;
+            for (uint32_t priority = 0; priority < P7R_N_PRIORITIES; priority++)
+                schedulers[index].policy.dispatch.weights[priority] = !weighted ? default_weights[priority] :
+                    (config.concurrency.dispatch.weights[priority] ? config.concurrency.dispatch.weights[priority] : 1);
+        }
+        schedulers[index].policy.busy_poll.max_ns = carrier_busy_polls(&config, index) ? config.concurrency.busy_poll.window_us * 1000ULL : 0;
+        (schedulers[index].policy.busy_poll.window_ns = schedulers[index].policy.busy_poll.max_ns),
+            (schedulers[index].policy.busy_poll.adaptive = config.concurrency.busy_poll.adaptive);
+        // carrier 0 hosts the pool itself, and stays up for placement to fall back on
+        (schedulers[index].elastic.park_after_ms = index ? config.concurrency.elastic.park_after_ms : 0), (schedulers[index].elastic.parked = 0);
     }
     {
         pthread_barrierattr_t barrier_attribute;
@@ -721,18 +2088,26 @@ int p7r_init(struct p7r_config config) {
         pthread_barrier_init(&carrier_barrier, &barrier_attribute, config.concurrency.n_carriers);
     }
     {
-        pthread_attr_t detach_attr;
-        pthread_attr_init(&detach_attr);
-        pthread_attr_setdetachstate(&detach_attr, PTHREAD_CREATE_DETACHED);
-        for (uint32_t index = 1; index < config.concurrency.n_carriers; index++)
+        // an attr of its own per carrier - an affinity set on a shared one would stick to every carrier after it
+        for (uint32_t index = 1; index < config.concurrency.n_carriers; index++) {
+            pthread_attr_t detach_attr;
+            pthread_attr_init(&detach_attr);
+            pthread_attr_setdetachstate(&detach_attr, PTHREAD_CREATE_DETACHED);
+            CPU_COUNT(&(cpu_sets[index])) && pthread_attr_setaffinity_np(&detach_attr, sizeof(cpu_set_t), &(cpu_sets[index]));
             pthread_create(&(carriers[index].pthread_id), &detach_attr, p7r_carrier_lifespan, &(carriers[index]));
+            pthread_attr_destroy(&detach_attr);
+        }
+        // carrier 0 is the calling thread
+        carriers[0].pthread_id = pthread_self();
+        CPU_COUNT(&(cpu_sets[0])) && pthread_setaffinity_np(carriers[0].pthread_id, sizeof(cpu_set_t), &(cpu_sets[0]));
+        scraft_deallocate(allocator, cpu_sets);
     }
     
     struct p7r_stack_metamark *main_sched_stack = 
-        stack_metamark_create(&(carriers[0].scheduler->runners.stack_allocator), P7R_STACK_POLICY_DEFAULT);
-    p7r_context_init(&(carriers[0].context), stack_meta_of(main_sched_stack), stack_size_of(main_sched_stack));
+        stack_metamark_create(&(carriers[0].scheduler->runners.stack_allocator), P7R_STACK_CLASS_DEFAULT, P7R_STACK_POLICY_DEFAULT);
+    p7r_context_init(&(carriers[0].context), stack_base_of(main_sched_stack), stack_size_of(main_sched_stack));
     p7r_context_prepare(&(carriers[0].context), (void (*)(void *)) p7r_carrier_lifespan, &(carriers[0]));
-    list_add_tail(&(main_uthread.linkable), &(carriers[0].scheduler->runners.sched_queues[P7R_SCHED_QUEUE_RUNNING]));
+    sched_runnable_enqueue(carriers[0].scheduler, &main_uthread);
     carriers[0].scheduler->runners.running = &main_uthread;
 
     p7r_context_switch(&(carriers[0].context), &(main_uthread.context));
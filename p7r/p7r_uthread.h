@@ -6,13 +6,36 @@
 #include    "./p7r_scraft_common.h"
 #include    "./p7r_uthread_def.h"
 
+#include    <stdio.h>
+
 
 int p7r_init(struct p7r_config config);
 struct p7r_delegation p7r_delegate(uint64_t events, ...);
 void p7r_yield(void);
 int p7r_uthread_create(void (*entrance)(void *), void *argument, void (*dtor)(void *), int yield);
+// stack_class is one of the configured size classes, or P7R_STACK_CLASS_AUTO
+int p7r_uthread_create_sized(void (*entrance)(void *), void *argument, void (*dtor)(void *), int yield, uint32_t stack_class);
+// priority is P7R_PRIORITY_*, the others inherit the one of the calling uthread
+int p7r_uthread_create_prioritized(void (*entrance)(void *), void *argument, void (*dtor)(void *), int yield, uint32_t priority);
+uint32_t p7r_priority(void);
+void p7r_set_priority(uint32_t priority);
+
+int p7r_uthread_create_foreign(
+        uint32_t target_carrier_index, 
+        void (*entrance)(void *), void *argument, void (*dtor)(void *), 
+        struct p7r_future *future, 
+        uint32_t stack_class,
+        uint32_t priority);
 
-int p7r_uthread_create_foreign(uint32_t target_carrier_index, void (*entrance)(void *), void *argument, void (*dtor)(void *), struct p7r_future *future);
+struct p7r_task {
+    void (*entrance)(void *);
+    void *argument;
+    void (*dtor)(void *);
+};
+
+// Spreads the tasks over all carriers in one pass, one message chain and at most one wakeup per carrier.
+// Returns how many got posted - those after an allocation failure are not, and their futures stay untouched.
+uint32_t p7r_uthread_create_foreign_batch(const struct p7r_task *tasks, struct p7r_future *const *futures, uint32_t n_tasks);
 
 struct p7r_carrier *p7r_carriers();
 uint32_t balanced_target_carrier(void);
@@ -20,4 +43,36 @@ uint32_t p7r_n_carriers(void);
 
 struct p7r_future *p7r_get_future(void);
 
+/*
+ * Parking for synchronization primitives. A waiter is a delegation of the running uthread with ALLOW_OOB armed;
+ * whoever claims it from the primitive's wait list calls p7r_waiter_wake exactly once, from any thread, and the
+ * waiter must not leave before that wake has arrived.
+ */
+int p7r_in_uthread(void);
+struct p7r_delegation *p7r_waiter_prepare(struct p7r_delegation *waiter);
+int p7r_waiter_park(struct p7r_delegation *waiter, uint64_t timeout_ms);
+void p7r_waiter_wake(struct p7r_delegation *waiter);
+
+// read with relaxed loads - every carrier keeps writing its own
+const struct p7r_carrier_counters *p7r_counters(uint32_t carrier_index);
+struct p7r_message_slab_stat p7r_message_stat(uint32_t carrier_index);
+struct p7r_stack_zone_stat p7r_stack_stat(uint32_t carrier_index, uint32_t zone);
+struct p7r_stack_zone_stat p7r_stack_class_stat(uint32_t carrier_index, uint32_t size_class, uint32_t zone);
+// per entrance stack high-water marks of all carriers, needs stack_allocator.high_water_profile
+void p7r_stack_profile_dump(FILE *stream);
+// Chrome trace JSON of the scheduler events still in the rings, needs trace.enabled - events written, -1 without
+int64_t p7r_trace_dump(FILE *stream);
+uint32_t p7r_bus_backend(uint32_t carrier_index);
+
+ssize_t p7r_read(int fd, void *buffer, size_t size);
+ssize_t p7r_write(int fd, const void *buffer, size_t size);
+int p7r_accept(int fd, struct sockaddr *address, socklen_t *address_length, int flags);
+
+int p7r_fd_register(struct p7r_fd *handle, int fd);
+void p7r_fd_unregister(struct p7r_fd *handle);
+struct p7r_delegation p7r_fd_wait(struct p7r_fd *handle, uint64_t events, ...);
+ssize_t p7r_fd_read(struct p7r_fd *handle, void *buffer, size_t size);
+ssize_t p7r_fd_write(struct p7r_fd *handle, const void *buffer, size_t size);
+int p7r_fd_accept(struct p7r_fd *handle, struct sockaddr *address, socklen_t *address_length, int flags);
+
 #endif      // P7R_UTHREAD_H_
@@ -6,10 +6,14 @@
 #include    "./p7r_scraft_common.h"
 
 #include    "./p7r_timing.h"
-#include    "./p7r_cpbuffer.h"
+#include    "./p7r_inbox.h"
+#include    "./p7r_message_slab.h"
+#include    "./p7r_uring.h"
 #include    "./p7r_stack_allocator_adaptor.h"
 #include    "./p7r_context.h"
 #include    "./p7r_future_def.h"
+#include    "./p7r_counters.h"
+#include    "./p7r_trace.h"
 
 
 struct p7r_uthread {
@@ -18,10 +22,14 @@ struct p7r_uthread {
     struct p7r_stack_metamark *stack_metamark;
     struct p7r_future *future;
     uint64_t status;
+    struct p7r_stack_hint *hint;            // of the entrance running now, NULL unless hints are tracked
+    uint64_t launched_at;
+    uint32_t priority;                      // P7R_PRIORITY_*, picks the run queue
     struct {
         void (*user_entrance)(void *);
         void (*real_entrance)(void *);
         void *user_argument, *real_argument;
+        void (*user_argument_dtor)(void *);
     } entrance;
     list_ctl_t linkable;
 };
@@ -31,6 +39,8 @@ struct p7r_uthread_request {
     void *user_argument;
     void (*user_argument_dtor)(void *);
     struct p7r_future *future;
+    uint32_t stack_class;
+    uint32_t priority;
     list_ctl_t linkable;
 };
 
@@ -44,6 +54,13 @@ struct p7r_uthread_request {
 
 #define     P7R_UTHREAD_STATUS_MASK     7
 
+// lower runs first - a priority is a run queue and a request queue of every scheduler
+#define     P7R_PRIORITY_CRITICAL       0
+#define     P7R_PRIORITY_NORMAL         1
+#define     P7R_PRIORITY_BACKGROUND     2
+#define     P7R_N_PRIORITIES            3
+#define     P7R_PRIORITY_INHERIT        UINT32_MAX      // of the spawning uthread, normal outside of uthreads
+
 struct p7r_timer_core {
     uint64_t timestamp;
     int triggered;
@@ -55,6 +72,31 @@ struct p7r_timer_queue {
     struct scraft_rbtree map;
 };
 
+#define     P7R_INTERNAL_U2CC               0x1         // vs. IUC
+#define     P7R_INTERNAL_ATTACHED           0x2         // vs. BUFFERED
+#define     P7R_MESSAGE_UNDEFINED           (0 << 2)
+#define     P7R_MESSAGE_UTHREAD_REQUEST     (1 << 2)
+#define     P7R_MESSAGE_STEAL_REQUEST       (2 << 2)
+#define     P7R_MESSAGE_STEAL_RESPONSE      (3 << 2)
+#define     P7R_MESSAGE_WAKEUP              (4 << 2)
+
+#define     P7R_MESSAGE_REAL_TYPE(type_)    (((type_) & ~3) >> 2)
+
+struct p7r_internal_message {
+    uint64_t type;
+    uint32_t from, to;
+    struct p7r_message_slab *slab;      // origin, NULL for the root allocator
+    list_ctl_t linkable, communicatable;
+    void (*content_destructor)(struct p7r_internal_message *);
+    void *(*content_extractor)(struct p7r_internal_message *);
+    char content_buffer;
+} __attribute__((packed));
+
+#define     P7R_BUFFERED_MESSAGE_SIZE(size_)    (sizeof(struct p7r_internal_message) - sizeof(char) + (size_))
+#define     P7R_MESSAGE_OF(buffer_)             container_of(((char *) buffer_), struct p7r_internal_message, content_buffer)
+// linkable through its offset - &(message->linkable) of a packed struct warns
+#define     P7R_MESSAGE_LINK_OF(message_)       ((list_ctl_t *) ((char *) (message_) + offset_of(struct p7r_internal_message, linkable)))
+
 struct p7r_delegation {
     uint64_t p7r_event;
     struct {
@@ -62,9 +104,13 @@ struct p7r_delegation {
             int fd;
             struct epoll_event epoll_event;
             int triggered, enabled;
+            uint32_t ring_slot;     // io_uring backend only
+            int32_t result;         // io_uring backend only - poll mask, or the outcome of a ring operation
         } io;
         struct {
             int triggered, enabled;
+            // what a wake from another carrier travels in - nothing left to allocate, so it cannot fail
+            struct p7r_internal_message wakeup;
         } oob;
         struct {
             struct p7r_timer_core measurement;
@@ -74,47 +120,171 @@ struct p7r_delegation {
     struct p7r_uthread *uthread;
 };
 
+/*
+ * Something a uthread can wait on besides fds and timers - passed to p7r_delegate along with ALLOW_OOB.
+ * arm() either completes on the spot (returns 1) or queues the delegation for a later p7r_waiter_wake (returns 0);
+ * disarm() dequeues it (returns 1), or returns 0 when that wake is already owed and must be waited for.
+ */
+struct p7r_oob_source {
+    int (*arm)(struct p7r_oob_source *source, struct p7r_delegation *delegation);
+    int (*disarm)(struct p7r_oob_source *source, struct p7r_delegation *delegation);
+};
+
 #define     P7R_DELEGATION_BASE         0
 #define     P7R_DELEGATION_READ         1
 #define     P7R_DELEGATION_WRITE        2
 #define     P7R_DELEGATION_ALLOW_OOB    (1 << 4)
 #define     P7R_DELEGATION_TIMED        (1 << 5)
+#define     P7R_DELEGATION_PERSISTENT   (1 << 6)        // the registration of a struct p7r_fd, never a waiter
+
+/*
+ * A fd registered once with its scheduler, edge-triggered, for as long as the handle lives.
+ *
+ * Edges only ever set bits in ready; an EAGAIN (or a short transfer) clears them. A uthread parks only while the
+ * bit it needs is clear, so a busy connection costs no epoll_ctl at all, and often not even the EAGAIN.
+ * Any number of uthreads may wait, each direction in arrival order; the handle belongs to the carrier which
+ * registered it.
+ */
+struct p7r_fd {
+    int fd;
+    uint32_t scheduler_index;
+    uint64_t ready;                         // P7R_DELEGATION_READ/WRITE
+    struct p7r_delegation registration;
+    list_ctl_t waiters[2];                  // struct p7r_fd_waiter parked in p7r_fd_wait, by direction
+};
+
+#define     P7R_FD_WAITER_READ          0
+#define     P7R_FD_WAITER_WRITE         1
+
+struct p7r_fd_waiter {
+    list_ctl_t linkable[2];                 // by direction, isolated where it does not wait
+    struct p7r_delegation *delegation;
+};
+
+struct p7r_bus_ring_slot {
+    struct p7r_delegation *delegation;      // NULL once abandoned - its completion is dropped
+    uint32_t next_free;
+    uint32_t next_owed;                     // chains the slots still owed a POLL_REMOVE
+    int remove_owed;                        // P7R_BUS_RING_REMOVE_*
+};
 
-#define     P7R_N_SCHED_QUEUES          3
+// one run queue per priority, the others behind them
+#define     P7R_N_SCHED_QUEUES          (P7R_N_PRIORITIES + 2)
 #define     P7R_SCHED_QUEUE_RUNNING     0
-#define     P7R_SCHED_QUEUE_BLOCKING    1
-#define     P7R_SCHED_QUEUE_DYING       2
+#define     P7R_SCHED_QUEUE_BLOCKING    P7R_N_PRIORITIES
+#define     P7R_SCHED_QUEUE_DYING       (P7R_N_PRIORITIES + 1)
+#define     P7R_SCHED_RUN_QUEUE(priority_)  (P7R_SCHED_QUEUE_RUNNING + (priority_))
+
+// whole pages per scheduler, so that each one can live on the node of its carrier
+#define     P7R_SCHEDULER_ALIGNMENT     4096
 
 struct p7r_scheduler {
     uint32_t index;
     uint32_t n_carriers;
     uint64_t status;
     struct {
-        list_ctl_t request_queue;
+        list_ctl_t request_queues[P7R_N_PRIORITIES];
         list_ctl_t sched_queues[P7R_N_SCHED_QUEUES];
+        uint32_t credits[P7R_N_PRIORITIES];     // dispatches left to each priority in this round
         struct p7r_uthread *running;
         struct p7r_context *carrier_context;
         struct p7r_stack_allocator stack_allocator;
+        struct p7r_stack_hint_dictionary stack_hints;
         uint64_t tokens;
     } runners;
     struct {
+        // written by the owner only, peeked by other carriers without locking
+        uint32_t n_runnable, n_requests, n_fresh;
+        uint32_t idle_permille;
+        // owner-private accounting behind idle_permille
+        uint64_t window_start, idle_ns;
+        uint32_t n_busy_refreshes;
+    } load;
+    struct {
+        uint32_t backend;       // P7R_BUS_BACKEND_*, what we actually got rather than what was asked for
         int fd_epoll;
+        struct p7r_uring ring;
+        struct p7r_bus_ring_slot *ring_slots;
+        uint32_t n_ring_slots, ring_slot_free;
+        uint32_t ring_removes_owed;         // submissions the full ring turned away, retried on each refresh
+        int ring_notification_owed;
+        int ring_operations;
         int fd_notification;
         struct p7r_delegation notification;
         int consumed;
-        struct p7r_cpbuffer *message_boxes;
-        struct p7r_cpbuffer *foreign_message_box;
+        int parked;             // P7R_BUS_*, producers only write fd_notification on the busy-to-parked edge
+        struct p7r_inbox inbox;
+        struct p7r_message_slab slab;
         struct p7r_timer_queue timers;
         struct epoll_event *epoll_events;
         int n_epoll_events;
+        int stealing;
+        uint32_t steal_cursor;
     } bus;
     struct {
         struct {
             int enabled;
             uint64_t max_tokens;
         } swarm;
+        struct {
+            int enabled;
+            uint32_t threshold;
+        } stealing;
+        struct {
+            int adaptive, profile;          // hints are tracked for either of them
+            double eden_below_us, prudent_above_us;
+        } stack_placement;
+        struct {
+            int strict;
+            uint32_t weights[P7R_N_PRIORITIES];
+        } dispatch;
+        struct {
+            uint64_t max_ns;                // 0 for a carrier which never polls
+            uint64_t window_ns;             // of the next spin, max_ns unless adaptive
+            int adaptive;
+        } busy_poll;
     } policy;
-};
+    struct {
+        uint32_t park_after_ms;         // 0 for a carrier which never parks
+        uint32_t parked;                // set by the carrier itself, cleared by whichever peer unparks it
+    } elastic;
+    uint32_t numa_node;
+    struct p7r_carrier_counters *counters;
+    uint32_t n_refreshes;               // since the last gauge update
+    struct p7r_trace_ring *trace;       // NULL unless tracing
+} __attribute__((aligned(P7R_SCHEDULER_ALIGNMENT)));
+
+#define     P7R_PLACEMENT_ROUND_ROBIN       0
+#define     P7R_PLACEMENT_LOAD_AWARE        1
+#define     P7R_N_PLACEMENT_POLICIES        2
+
+#define     P7R_PLACEMENT_DEFAULT_SATURATION    16
+#define     P7R_LOAD_WINDOW_NS              (10 * 1000 * 1000)
+#define     P7R_LOAD_BUSY_REFRESHES         64          // refreshes without a sleep between two looks at the window
+
+#define     P7R_STEAL_DEFAULT_THRESHOLD     2
+#define     P7R_STEAL_MAX_PRELAUNCH_SCAN    64
+
+#define     P7R_DISPATCH_DEFAULT_WEIGHTS    { 16, 4, 1 }
+
+#define     P7R_ELASTIC_DEFAULT_UNPARK_DEPTH    16
+
+#define     P7R_BUSY_POLL_BUS_EVERY     16              // spin rounds between two non-blocking looks at the bus
+
+#define     P7R_BUS_BUSY                0
+#define     P7R_BUS_PARKED              1
+
+#define     P7R_BUS_BACKEND_EPOLL       0
+#define     P7R_BUS_BACKEND_URING       1
+#define     P7R_N_BUS_BACKENDS          2
+
+#define     P7R_BUS_RING_NOTIFICATION   0               // ring slot reserved for the eventfd
+#define     P7R_BUS_RING_UNTRACKED      UINT64_MAX      // user_data of completions nobody waits for
+#define     P7R_BUS_RING_NO_SLOT        UINT32_MAX
+
+#define     P7R_BUS_RING_REMOVE_NONE    0
+#define     P7R_BUS_RING_REMOVE_OWED    1
+#define     P7R_BUS_RING_REMOVE_MOOT    2               // the poll ended on its own before we got to remove it
 
 #define     P7R_SCHEDULER_BORN          0
 #define     P7R_SCHEDULER_ALIVE         1
@@ -127,25 +297,6 @@ struct p7r_carrier {
     struct p7r_scheduler *scheduler;
 };
 
-#define     P7R_INTERNAL_U2CC               0x1         // vs. IUC
-#define     P7R_INTERNAL_ATTACHED           0x2         // vs. BUFFERED
-#define     P7R_MESSAGE_UNDEFINED           (0 << 2)
-#define     P7R_MESSAGE_UTHREAD_REQUEST     (1 << 2)
-
-#define     P7R_MESSAGE_REAL_TYPE(type_)    (((type_) & ~3) >> 2)
-
-struct p7r_internal_message {
-    uint64_t type;
-    uint32_t from, to;
-    list_ctl_t linkable, communicatable;
-    void (*content_destructor)(struct p7r_internal_message *);
-    void *(*content_extractor)(struct p7r_internal_message *);
-    char content_buffer;
-} __attribute__((packed));
-
-#define     P7R_BUFFERED_MESSAGE_SIZE(size_)    (sizeof(struct p7r_internal_message) - sizeof(char) + (size_))
-#define     P7R_MESSAGE_OF(buffer_)             container_of(((char *) buffer_), struct p7r_internal_message, content_buffer)
-
 struct p7r_config {
     struct {
         uint32_t n_carriers;
@@ -154,6 +305,47 @@ struct p7r_config {
             int enabled;
             uint64_t max_tokens;
         } swarm;
+        struct {
+            int enabled;
+            uint32_t threshold;     // minimum pending requests of a victim, 0 for default
+        } stealing;
+        struct {
+            uint32_t backend;       // P7R_BUS_BACKEND_*, io_uring falls back to epoll where unavailable
+            uint32_t ring_entries;  // submission queue depth, 0 for default
+            int ring_operations;    // p7r_read/p7r_write/p7r_accept go through the ring instead of readiness + syscall
+        } bus;
+        struct {
+            uint32_t policy;        // P7R_PLACEMENT_*
+            uint32_t saturation;    // local queue depth beyond which work leaves the carrier, 0 for default
+        } placement;
+        struct {
+            int pinned;             // pin every carrier to CPUs of its own
+            // carrier i runs on cpus[i * width] to cpus[i * width + width - 1], wrapping around - NULL for the CPUs
+            // the process is allowed on, in order
+            const uint32_t *cpus;
+            uint32_t n_cpus, width; // width 0 for 1
+            int numa_local;         // pinned carriers keep scheduler, stacks and message slabs on the node of their first CPU
+        } affinity;
+        struct {
+            // how long an idle carrier polls for work before it sleeps, 0 to sleep right away - pays off only for
+            // carriers with a CPU of their own
+            uint32_t window_us;
+            int adaptive;           // halve the window after each spin in vain, reopen it after a sleep it would have covered
+            const uint32_t *carriers;   // indices of the carriers which poll - NULL for all of them
+            uint32_t n_carriers;
+        } busy_poll;
+        struct {
+            int strict;             // always the most urgent priority with work, instead of weighted rounds
+            uint32_t weights[P7R_N_PRIORITIES];     // dispatches of each priority per round, all 0 for default
+        } dispatch;
+        struct {
+            // A carrier idle for this long parks: placement passes it by, it steals and polls no more, and its
+            // freed stacks go back to the kernel. It still runs whatever reaches it. 0 never to park.
+            uint32_t park_after_ms;
+            uint32_t min_carriers;  // never fewer unparked, carrier 0 always among them - 0 for 1
+            // queued uthreads and requests per unparked carrier beyond which a parked one comes back, 0 for default
+            uint32_t unpark_depth;
+        } elastic;
     } concurrency;
     struct {
         void *(*allocate)(size_t);
@@ -166,6 +358,19 @@ struct p7r_config {
         uint32_t n_elements;
     } arena;
     struct p7r_stack_allocator_config stack_allocator;
+    struct {
+        int exported;               // counters go to a memfd which other processes can map, see p7r_counters.h
+    } counters;
+    struct {
+        int enabled;                // record scheduler events into per-carrier rings, see p7r_trace.h
+        uint32_t n_events;          // kept per carrier, rounded up to a power of 2 - 0 for default
+    } trace;
+    struct {
+        int adaptive;               // place stacks by the observed lifetime of their entrance
+        uint32_t n_hints;           // entrances tracked per carrier, 0 for default
+        uint32_t eden_below_us;     // average lifetime under which an entrance goes short-term, 0 for default
+        uint32_t prudent_above_us;  // and above which it goes long-term, 0 for default
+    } stack_placement;
 };
 
 #endif      // P7R_UTHREAD_DEF_H_
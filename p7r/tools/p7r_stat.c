@@ -0,0 +1,168 @@
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+#include    <stdint.h>
+#include    <unistd.h>
+#include    <fcntl.h>
+#include    <dirent.h>
+#include    <time.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+
+#include    "../p7r_counters.h"
+
+/*
+ * Per-carrier counters of a running p7r process, read from the memfd it exports under counters.exported.
+ * Once without an interval; otherwise every interval, with monotonic counters as rates since the sample before.
+ * Stacks show as committed/resident KiB per zone. Parks under concurrency.elastic show as a count since the sample
+ * before, with a * on carriers parked right now.
+ *
+ * usage: p7r_stat <pid> [interval_ms] [n_samples]
+ */
+
+static
+int counters_fd_of(long pid) {
+    char path[64], target[256];
+    snprintf(path, sizeof(path), "/proc/%ld/fd", pid);
+    DIR *fds = opendir(path);
+    if (fds == NULL)
+        return -1;
+    int fd = -1;
+    struct dirent *entry;
+    while ((fd == -1) && ((entry = readdir(fds)) != NULL)) {
+        if (entry->d_name[0] == '.')
+            continue;
+        char link[64 + 256];
+        snprintf(link, sizeof(link), "%s/%s", path, entry->d_name);
+        ssize_t length = readlink(link, target, sizeof(target) - 1);
+        if (length <= 0)
+            continue;
+        target[length] = '\0';
+        if (strncmp(target, "/memfd:" P7R_COUNTERS_NAME, strlen("/memfd:" P7R_COUNTERS_NAME)) == 0)
+            fd = open(link, O_RDONLY|O_CLOEXEC);
+    }
+    closedir(fds);
+    return fd;
+}
+
+static
+const struct p7r_counters_segment *counters_map(int fd) {
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) == -1) || ((size_t) file_stat.st_size < sizeof(struct p7r_counters_segment)))
+        return NULL;
+    const struct p7r_counters_segment *segment = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (segment == MAP_FAILED)
+        return NULL;
+    if ((__atomic_load_n(&(segment->magic), __ATOMIC_ACQUIRE) != P7R_COUNTERS_MAGIC) ||
+            (segment->version != P7R_COUNTERS_VERSION) ||
+            ((size_t) file_stat.st_size < P7R_COUNTERS_SEGMENT_SIZE(segment->n_carriers))) {
+        munmap((void *) segment, file_stat.st_size);
+        return NULL;
+    }
+    return segment;
+}
+
+#define     counter_of(counters_, field_)   __atomic_load_n(&((counters_)->field_), __ATOMIC_RELAXED)
+
+static
+void counters_load(const struct p7r_carrier_counters *source, struct p7r_carrier_counters *sample) {
+    (sample->n_switches = counter_of(source, n_switches)), (sample->n_bus_waits = counter_of(source, n_bus_waits));
+    (sample->n_bus_sleeps = counter_of(source, n_bus_sleeps)), (sample->slept_ns = counter_of(source, slept_ns));
+    (sample->n_messages_sent = counter_of(source, n_messages_sent)), (sample->n_messages_received = counter_of(source, n_messages_received));
+    (sample->n_spawned = counter_of(source, n_spawned)), (sample->n_reincarnated = counter_of(source, n_reincarnated));
+    (sample->n_reaped = counter_of(source, n_reaped)), (sample->n_parks = counter_of(source, n_parks));
+    (sample->n_runnable = counter_of(source, n_runnable)), (sample->n_requests = counter_of(source, n_requests));
+    for (uint32_t zone = 0; zone < P7R_COUNTERS_N_STACK_ZONES; zone++) {
+        sample->stack_bytes_reserved[zone] = counter_of(source, stack_bytes_reserved[zone]);
+        sample->stack_bytes_committed[zone] = counter_of(source, stack_bytes_committed[zone]);
+        sample->stack_bytes_resident[zone] = counter_of(source, stack_bytes_resident[zone]);
+    }
+    (sample->n_slaves = counter_of(source, n_slaves)), (sample->parked = counter_of(source, parked));
+    sample->updated_at = counter_of(source, updated_at);
+}
+
+static
+void counters_print_header(int rates) {
+    printf("%-7s %12s %12s %12s %9s %12s %12s %10s %10s %10s %8s %8s %13s %13s %13s %6s %7s\n",
+        "carrier", rates ? "switch/s" : "switches", rates ? "wait/s" : "waits", rates ? "sleep/s" : "sleeps", "slept%",
+        rates ? "sent/s" : "sent", rates ? "recv/s" : "received", rates ? "spawn/s" : "spawned", rates ? "reinc/s" : "reincarn.",
+        rates ? "reap/s" : "reaped", "runnable", "requests", "stack long", "stack short", "stack slaves", "slaves", "parks");
+}
+
+static
+void counters_print(uint32_t index, const struct p7r_carrier_counters *now, const struct p7r_carrier_counters *before, uint64_t elapsed_ns) {
+    // without a sample before, totals - and how much of the run went asleep is not known
+    struct p7r_carrier_counters zero;
+    memset(&zero, 0, sizeof(zero));
+    double scale = before ? 1e9 / (double) elapsed_ns : 1.0;
+    char slept[16] = "-", stacks[P7R_COUNTERS_N_STACK_ZONES][32];
+    before && snprintf(slept, sizeof(slept), "%.1f%%", 100.0 * (double) (now->slept_ns - before->slept_ns) / (double) elapsed_ns);
+    before || (before = &zero);
+    for (uint32_t zone = 0; zone < P7R_COUNTERS_N_STACK_ZONES; zone++)
+        snprintf(stacks[zone], sizeof(stacks[zone]), "%lu/%lu", now->stack_bytes_committed[zone] >> 10, now->stack_bytes_resident[zone] >> 10);
+    printf("%-7u %12.0f %12.0f %12.0f %9s %12.0f %12.0f %10.0f %10.0f %10.0f %8lu %8lu %13s %13s %13s %6lu %6lu%s\n",
+        index,
+        (now->n_switches - before->n_switches) * scale, (now->n_bus_waits - before->n_bus_waits) * scale,
+        (now->n_bus_sleeps - before->n_bus_sleeps) * scale, slept,
+        (now->n_messages_sent - before->n_messages_sent) * scale, (now->n_messages_received - before->n_messages_received) * scale,
+        (now->n_spawned - before->n_spawned) * scale, (now->n_reincarnated - before->n_reincarnated) * scale,
+        (now->n_reaped - before->n_reaped) * scale,
+        now->n_runnable, now->n_requests, stacks[0], stacks[1], stacks[2], now->n_slaves, now->n_parks - before->n_parks,
+        now->parked ? "*" : " ");
+}
+
+static
+uint64_t now_ns(void) {
+    struct timespec timeval;
+    clock_gettime(CLOCK_MONOTONIC, &timeval);
+    return ((uint64_t) timeval.tv_sec * 1000 * 1000 * 1000) + (uint64_t) timeval.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <pid> [interval_ms] [n_samples]\n", argv[0]);
+        return 2;
+    }
+    long pid = strtol(argv[1], NULL, 10);
+    uint64_t interval_ms = (argc > 2) ? strtoull(argv[2], NULL, 0) : 0;
+    uint64_t n_samples = (argc > 3) ? strtoull(argv[3], NULL, 0) : 0;
+
+    int fd = counters_fd_of(pid);
+    if (fd == -1) {
+        fprintf(stderr, "no p7r counters found in process %ld - is counters.exported set, and may we look at it?\n", pid);
+        return 1;
+    }
+    const struct p7r_counters_segment *segment = counters_map(fd);
+    close(fd);
+    if (segment == NULL) {
+        fprintf(stderr, "process %ld exports counters of another layout\n", pid);
+        return 1;
+    }
+
+    uint32_t n = segment->n_carriers;
+    struct p7r_carrier_counters *samples = calloc(2 * n, sizeof(struct p7r_carrier_counters));
+    if (samples == NULL)
+        return 1;
+    struct p7r_carrier_counters *now = samples, *before = samples + n, *swap;
+    uint64_t sampled_at = now_ns(), sampled_before = sampled_at;
+    for (uint32_t index = 0; index < n; index++)
+        counters_load(&(segment->carriers[index]), &(now[index]));
+    if (interval_ms == 0) {
+        counters_print_header(0);
+        for (uint32_t index = 0; index < n; index++)
+            counters_print(index, &(now[index]), NULL, 0);
+        return 0;
+    }
+    for (uint64_t sample = 0; (n_samples == 0) || (sample < n_samples); sample++) {
+        (swap = before), (before = now), (now = swap), (sampled_before = sampled_at);
+        usleep(interval_ms * 1000);
+        sampled_at = now_ns();
+        for (uint32_t index = 0; index < n; index++)
+            counters_load(&(segment->carriers[index]), &(now[index]));
+        counters_print_header(1);
+        for (uint32_t index = 0; index < n; index++)
+            counters_print(index, &(now[index]), &(before[index]), sampled_at - sampled_before);
+        fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include    <stdio.h>
+#include    <stdlib.h>
+#include    <string.h>
+#include    <stdint.h>
+#include    <unistd.h>
+#include    <fcntl.h>
+#include    <dirent.h>
+#include    <sys/mman.h>
+#include    <sys/stat.h>
+
+#include    "../p7r_trace.h"
+
+/*
+ * Scheduler event rings of a running p7r process, as it records them under trace.enabled, written out as Chrome
+ * trace JSON - for chrome://tracing or ui.perfetto.dev. Entrances show as file+offset, for addr2line to name.
+ *
+ * usage: p7r_trace <pid> [output]
+ */
+
+struct trace_mapping {
+    uint64_t begin, end, offset;
+    char path[256];
+};
+
+struct trace_mappings {
+    struct trace_mapping *mappings;
+    uint32_t n_mappings;
+};
+
+static
+int trace_fd_of(long pid) {
+    char path[64], target[256];
+    snprintf(path, sizeof(path), "/proc/%ld/fd", pid);
+    DIR *fds = opendir(path);
+    if (fds == NULL)
+        return -1;
+    int fd = -1;
+    struct dirent *entry;
+    while ((fd == -1) && ((entry = readdir(fds)) != NULL)) {
+        if (entry->d_name[0] == '.')
+            continue;
+        char link[64 + 256];
+        snprintf(link, sizeof(link), "%s/%s", path, entry->d_name);
+        ssize_t length = readlink(link, target, sizeof(target) - 1);
+        if (length <= 0)
+            continue;
+        target[length] = '\0';
+        if (strncmp(target, "/memfd:" P7R_TRACE_NAME, strlen("/memfd:" P7R_TRACE_NAME)) == 0)
+            fd = open(link, O_RDONLY|O_CLOEXEC);
+    }
+    closedir(fds);
+    return fd;
+}
+
+static
+const struct p7r_trace_segment *trace_map(int fd) {
+    struct stat file_stat;
+    if ((fstat(fd, &file_stat) == -1) || ((size_t) file_stat.st_size < sizeof(struct p7r_trace_segment)))
+        return NULL;
+    const struct p7r_trace_segment *segment = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (segment == MAP_FAILED)
+        return NULL;
+    if ((__atomic_load_n(&(segment->magic), __ATOMIC_ACQUIRE) != P7R_TRACE_MAGIC) ||
+            (segment->version != P7R_TRACE_VERSION) ||
+            ((size_t) file_stat.st_size < P7R_TRACE_SEGMENT_SIZE(segment->n_carriers, segment->n_events))) {
+        munmap((void *) segment, file_stat.st_size);
+        return NULL;
+    }
+    return segment;
+}
+
+// executable mappings with a file behind them - nothing else has entrances
+static
+void trace_mappings_load(long pid, struct trace_mappings *mappings) {
+    char path[64], line[512], permissions[8];
+    snprintf(path, sizeof(path), "/proc/%ld/maps", pid);
+    (mappings->mappings = NULL), (mappings->n_mappings = 0);
+    FILE *maps = fopen(path, "r");
+    if (maps == NULL)
+        return;
+    uint32_t capacity = 0;
+    while (fgets(line, sizeof(line), maps)) {
+        struct trace_mapping mapping;
+        if ((sscanf(line, "%lx-%lx %7s %lx %*s %*s %255s", &(mapping.begin), &(mapping.end), permissions, &(mapping.offset), mapping.path) != 5) ||
+                (permissions[2] != 'x') || (mapping.path[0] != '/'))
+            continue;
+        if (mappings->n_mappings == capacity) {
+            struct trace_mapping *grown = realloc(mappings->mappings, sizeof(struct trace_mapping) * (capacity = capacity ? capacity * 2 : 16));
+            if (grown == NULL)
+                break;
+            mappings->mappings = grown;
+        }
+        mappings->mappings[mappings->n_mappings++] = mapping;
+    }
+    fclose(maps);
+}
+
+static
+const char *trace_name_of_mapping(uint64_t entrance, char *buffer, size_t size, void *context) {
+    struct trace_mappings *mappings = context;
+    for (uint32_t index = 0; index < mappings->n_mappings; index++) {
+        struct trace_mapping *mapping = &(mappings->mappings[index]);
+        if ((entrance < mapping->begin) || (entrance >= mapping->end))
+            continue;
+        const char *file = strrchr(mapping->path, '/');
+        snprintf(buffer, size, "%s+0x%lx", file ? file + 1 : mapping->path, entrance - mapping->begin + mapping->offset);
+        return buffer;
+    }
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <pid> [output]\n", argv[0]);
+        return 2;
+    }
+    long pid = strtol(argv[1], NULL, 10);
+
+    int fd = trace_fd_of(pid);
+    if (fd == -1) {
+        fprintf(stderr, "no p7r trace found in process %ld - is trace.enabled set, and may we look at it?\n", pid);
+        return 1;
+    }
+    const struct p7r_trace_segment *segment = trace_map(fd);
+    close(fd);
+    if (segment == NULL) {
+        fprintf(stderr, "process %ld records a trace of another layout\n", pid);
+        return 1;
+    }
+
+    FILE *output = (argc > 2) ? fopen(argv[2], "w") : stdout;
+    if (output == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+    struct trace_mappings mappings;
+    trace_mappings_load(pid, &mappings);
+    int64_t n_written = p7r_trace_export_chrome(output, segment, trace_name_of_mapping, &mappings);
+    (output != stdout) && fclose(output);
+    if (n_written < 0) {
+        fprintf(stderr, "failed to write the trace\n");
+        return 1;
+    }
+    fprintf(stderr, "%ld events\n", n_written);
+    return 0;
+}
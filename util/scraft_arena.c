@@ -12,7 +12,7 @@ static uint32_t lb_token_shared = 0;
 static __thread uint32_t thread_token_cached = -1;
 #define     SCRAFT_ARENA_THREAD_TOKEN   thread_token_cached
 #define     try_default_token \
-    do { if (unlikely(thread_token_cached < 0)) thread_token_cached = __atomic_fetch_add(&lb_token_shared, 1, __ATOMIC_ACQ_REL); } while (0)
+    do { if (unlikely(thread_token_cached == (uint32_t) -1)) thread_token_cached = __atomic_fetch_add(&lb_token_shared, 1, __ATOMIC_ACQ_REL); } while (0)
 #else
 #define     try_default_token
 #endif
@@ -55,9 +55,9 @@ int scraft_arena_init(struct scraft_model_alloc allocator, uint32_t n_elements,
 
     (arena_instance.allocator = allocator), (arena_instance.n_elements = n_elements), (arena_instance.n_slots = n_slots);
 
-    pthread_spinlock_t *guards __attribute__((cleanup(local_cleanup_guards)));
-    struct scraft_arena_element *elements __attribute__((cleanup(local_cleanup_elements)));
-    list_ctl_t *slots __attribute__((cleanup(local_cleanup_slots)));
+    pthread_spinlock_t *guards __attribute__((cleanup(local_cleanup_guards))) = NULL;
+    struct scraft_arena_element *elements __attribute__((cleanup(local_cleanup_elements))) = NULL;
+    list_ctl_t *slots __attribute__((cleanup(local_cleanup_slots))) = NULL;
 
     if (unlikely((guards = scraft_allocate(allocator, sizeof(pthread_spinlock_t) * n_slots)) == NULL))
         return -1;
@@ -77,6 +77,8 @@ int scraft_arena_init(struct scraft_model_alloc allocator, uint32_t n_elements,
         arena_instance.elements[element_index].cached = 1;
         list_add_tail(&(arena_instance.elements[element_index].lctl), &(arena_instance.slots[target_slot]));
     }
+    // the arena owns them from now on - keep the cleanups off
+    (guards = NULL), (elements = NULL), (slots = NULL);
     return 0;
 }
 
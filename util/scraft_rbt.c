@@ -41,6 +41,7 @@ void rbt_right_rotate(struct scraft_rbtree_node **root, struct scraft_rbtree_nod
 
 void scraft_rbt_insert(struct scraft_rbtree *tree, struct scraft_rbtree_node *node) {
     struct scraft_rbtree_node **root = &(tree->root), *tmp = NULL;
+    node->meta = tree;      // before rebalancing walks node up the tree
     if (unlikely(tree->root == tree->sentinel)) {
         (tree->root = node), (tree->root->parent = NULL), (tree->root->left = tree->root->right = tree->sentinel), (tree->root->color = SCRAFT_RBT_BLACK);
         return;
@@ -76,7 +77,6 @@ void scraft_rbt_insert(struct scraft_rbtree *tree, struct scraft_rbtree_node *no
         }
     }
     (*root)->color = SCRAFT_RBT_BLACK;
-    node->meta = tree;
 }
 
 
@@ -178,7 +178,7 @@ void scraft_rbt_delete(struct scraft_rbtree *tree, struct scraft_rbtree_node *no
 
 void scraft_rbt_detach(struct scraft_rbtree_node *node) {
     if (node->meta)
-        scraft_rbt_delete(node->meta, node);
+        scraft_rbt_delete(node->meta, node), (node->meta = NULL);
 }
 
 struct scraft_rbtree_node *scraft_rbt_find(struct scraft_rbtree *tree, const void *key) {